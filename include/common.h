@@ -11,6 +11,8 @@
 
 #define PERROR(...) {fprintf(stderr,"[ERROR]: ");fprintf(stderr,__VA_ARGS__);fprintf(stderr,"\n");exit(1);}
 
-#define CPU_CORES 8
+// cores this process may run on, detected at runtime (see topology.h)
+extern uint8_t available_cores(void);
+#define CPU_CORES available_cores()
 
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef IMAGE_EXPORT_H
+#define IMAGE_EXPORT_H
+
+#include "maze.h"
+#include "solver.h"
+
+// Pixel rows rendered by a worker before they are written to disk
+#define EXPORT_BAND_ROWS 16
+
+// Writes the maze as a binary PPM (P6) image with (2*x+1) x (2*y+1) pixels:
+// one pixel per cell, one per passage between cells and one per wall corner.
+// When state is not NULL, explored cells are colored by the worker that
+// explored them and the solution path (traced through explored_from) is
+// highlighted. The image is rendered band by band by the given number of
+// workers, each band is written at its offset in the file as soon as it is
+// done, so memory use is workers * EXPORT_BAND_ROWS rows of pixels.
+void export_maze_image(maze_t maze, solver_state_t *state, const char *path, uint8_t workers);
+
+#endif // IMAGE_EXPORT_H
@@ -5,6 +5,9 @@
 
 typedef uint32_t int_t;
 typedef uint8_t direction_t;
+// index of a cell in the maze data, x + y*width needs more than 32 bits
+// past 65536x65536 cells
+typedef uint64_t index_t;
 
 typedef struct {
     int_t x,y;
@@ -21,10 +24,10 @@ enum direction{ NORTH=1,EAST=2,SOUTH=4,WEST=8 };
 typedef struct{
     maze_vertex_t * data;
     vec2_t true_dimensions;
-    int_t start;
+    index_t start;
     vec2_t dimensions;
 } maze_t;
-#define maze_at(maze,_x,_y) ((maze).data[(maze).start + (_x) + (_y)*(maze).true_dimensions.x])
+#define maze_at(maze,_x,_y) ((maze).data[(maze).start + (_x) + (index_t)(_y)*(maze).true_dimensions.x])
 
 
 // alocates the *data* for a maze for the first time
@@ -34,6 +37,20 @@ typedef struct{
 // Now maze.data is not NULL
 extern void alloc_maze(maze_t *maze,int_t dim_x, int_t dim_y);
 
+// alloc_maze for a part that runs on workers threads, each taking a band
+// of rows: the rows of worker i are placed on its node (see first_touch).
+// alloc_maze places them for available_cores() workers
+extern void alloc_maze_for_workers(maze_t *maze,int_t dim_x, int_t dim_y, uint8_t workers);
+
+// zeroed memory for count elements, like calloc. Large arrays are aligned
+// to and advised as huge pages, so giant mazes don't spend their time in
+// TLB misses. The memory is released with free()
+extern void *alloc_cells(index_t count, size_t size);
+
+// alloc_cells with the pages of the i-th of workers bands on the node of
+// worker i, for the arrays of a part that runs on workers threads
+extern void *alloc_cells_for_workers(index_t count, size_t size, uint8_t workers);
+
 
 // gets a sub-maze of a bigger maze, that points to the same data in memory
 // suppose we have the maze:
@@ -52,6 +69,25 @@ extern maze_t get_sub_maze(maze_t maze,int_t start_x,int_t start_y,int_t end_x,i
 // hard to understand when using this visualization.
 extern void print_maze(maze_t maze);
 
+// writes the same drawing as print_maze, UTF-8 encoded, to any file descriptor
+extern void write_maze(maze_t maze, int fd);
+
+
+// window of a maze, in cells
+typedef struct {
+    vec2_t origin;
+    vec2_t size;
+} viewport_t;
+
+// viewport covering the whole maze
+extern viewport_t full_viewport(maze_t maze);
+
+// viewport of the given size centred on a cell, clamped to the maze
+extern viewport_t viewport_around(maze_t maze, vec2_t center, vec2_t size);
+
+// prints only the cells inside the viewport
+extern void print_maze_viewport(maze_t maze, viewport_t view);
+
 
 // gets a random direction between one of the available directions
 extern direction_t random_direction(direction_t available);
@@ -61,17 +97,79 @@ extern void print_direction(direction_t direction);
 // splits a maze into parts, that points to the same data in memory
 extern void split_maze(maze_t maze ,maze_t *target,uint8_t parts);
 
+// splits a maze into a grid of tiles of tile_side x tile_side cells (smaller
+// on the right and bottom edges), left to right, top to bottom. The tiles
+// point to the same data, the array is allocated and the grid size is
+// stored in *grid
+extern maze_t *tile_maze(maze_t maze, int_t tile_side, vec2_t *grid);
+
+// connects a grid of tiles, each one a perfect maze, into one perfect maze:
+// the tiles are joined along a random spanning tree of the grid, with one
+// passage at a random place of the boundary between joined tiles
+extern void glue_tiles(maze_t *tiles, vec2_t grid, uint64_t seed);
 
-// generates a random maze using the Markov Chain Montecarlo method
-extern maze_t generate_random_maze_MCMC(int_t dim_x,int_t dim_y, uint64_t number_of_iterations);
 
-// generates a random maze using the Hillbert Lookahead method
-extern maze_t generate_random_maze_hillbert_lookahead(uint64_t side);
+// Every generator takes a seed: the same seed gives the same maze, in the
+// parallel generators whatever the number of workers.
 
-// generates a random maze using the Markov Chain Montecarlo method in parallel
-// the maze must be square, its side must be a power of two, and the number of workers
-// must also be a power of two.
-extern maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers);
+// generates a random maze using the Markov Chain Montecarlo method
+extern maze_t generate_random_maze_MCMC(int_t dim_x,int_t dim_y, uint64_t number_of_iterations, uint64_t seed);
+
+// generates a random maze with the Markov Chain Montecarlo method, walking
+// until the origin has visited coverage (in (0,1]) of the cells instead of
+// for a given number of iterations. At 1 it stops at the cover time, when
+// nothing is left of the starting maze. The iterations it took go to
+// *iterations_used, if not NULL
+extern maze_t generate_random_maze_MCMC_adaptive(int_t dim_x,int_t dim_y,double coverage,uint64_t *iterations_used,uint64_t seed);
+
+// generates a random maze using the Hillbert Lookahead method, workers
+// threads take bands of rows and the maze doesn't depend on their number
+extern maze_t generate_random_maze_hillbert_lookahead(uint64_t side, uint8_t workers, uint64_t seed);
+
+// generates a random maze with the lookahead method along a generalized
+// Hilbert curve, for any dimensions
+extern maze_t generate_random_maze_gilbert_lookahead(int_t dim_x,int_t dim_y,uint8_t workers,uint64_t seed);
+
+// generates a random perfect maze using the Markov Chain Montecarlo method in
+// parallel. The maze is split in a fixed grid of tiles, the iterations are
+// shared between them and the tiles are joined with glue_tiles
+extern maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers,uint64_t seed);
+
+// generates a random perfect maze with the Markov Chain Montecarlo method,
+// one origin per tile of a fixed grid walking at the same time on a single
+// tree of the whole maze. The active tiles alternate so the origins cross
+// the tile borders, and no seams are left. The same for any number of workers
+extern maze_t generate_random_maze_MCMC_multiwalker(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers,uint64_t seed);
+
+// generates a uniformly random perfect maze with Wilson's algorithm
+// (loop erased random walks), in linear expected time
+extern maze_t generate_random_maze_wilson(int_t dim_x,int_t dim_y,uint64_t seed);
+
+// generates a perfect maze with Wilson's algorithm in parallel: every tile
+// of a fixed grid is a uniform spanning tree of its own, and the tiles are
+// joined along a random spanning tree of the grid. Not uniform over the
+// whole maze, but the same for any number of workers
+extern maze_t generate_random_maze_wilson_parallel(int_t dim_x,int_t dim_y,uint8_t workers,uint64_t seed);
+
+// generates a perfect maze with Kruskal's algorithm on random passage weights,
+// in parallel: the passages are sorted by workers and accepted in order
+// with a concurrent union find. The same maze for any number of workers
+extern maze_t generate_random_maze_kruskal(int_t dim_x,int_t dim_y,uint8_t workers,uint64_t seed);
+
+// generates a perfect maze by recursive division: long straight walls, each
+// with a single gap, down to corridors one cell wide. The halves of every
+// cut are divided as tasks of a work stealing pool
+extern maze_t generate_random_maze_division(int_t dim_x,int_t dim_y,uint8_t workers,uint64_t seed);
+
+// generates a perfect maze row by row with Eller's algorithm, see
+// write_maze_file_eller to stream one to a file instead
+extern maze_t generate_random_maze_eller(int_t dim_x,int_t dim_y,uint64_t seed);
+
+// turns a perfect maze into one with loops: about fraction of its dead ends
+// (in [0,1]) get a wall opened, towards another dead end when there is
+// one. Done in parallel over tiles, the same for any number of workers.
+// Returns the number of walls opened
+extern index_t braid_maze(maze_t maze, double fraction, uint8_t workers, uint64_t seed);
 
 
 
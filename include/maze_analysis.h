@@ -0,0 +1,47 @@
+#ifndef MAZE_ANALYSIS_H
+#define MAZE_ANALYSIS_H
+
+#include "maze.h"
+
+// corridors of 2^i to 2^(i+1)-1 cells go to corridor_length[i]
+#define MAZE_CORRIDOR_BUCKETS 32
+// solution_length of cells that can't reach each other
+#define MAZE_NO_PATH ((index_t)-1)
+
+enum maze_kind {
+    MAZE_INVALID,               // walls open on one side only or to the outside
+    MAZE_DISCONNECTED,          // some cells can't be reached from others
+    MAZE_PERFECT,               // a tree: one path between any two cells
+    MAZE_BRAIDED,               // connected, with loops
+};
+
+// What a maze is made of. A passage is a wall open on both sides, the
+// degree of a cell is its number of passages (1 for a dead end, 3 or 4 for
+// a junction) and a corridor is a run of cells of degree 2 between cells
+// that aren't. Walls open on one side only or to the outside are counted
+// and otherwise ignored.
+typedef struct {
+    index_t cells, passages;
+    index_t asymmetric;         // walls open on one side only
+    index_t outside;            // walls open to the outside of the maze
+    index_t components;         // parts that can't reach each other
+    index_t degree[5];          // cells by degree
+    index_t corridors, longest_corridor;
+    index_t corridor_length[MAZE_CORRIDOR_BUCKETS];
+    index_t solution_length;    // steps from start to goal
+    enum maze_kind kind;
+} maze_analysis_t;
+
+// checks and measures maze in one pass over bands of rows with workers
+// threads, then finds the shortest path from start to goal searching from
+// both (2 bits per cell, start == goal skips it). A maze is perfect when it
+// is valid, connected and has cells-1 passages.
+// Rings of cells of degree 2 only, without a junction or a dead end, have
+// no ends and aren't counted as corridors
+extern maze_analysis_t analyze_maze(maze_t maze, vec2_t start, vec2_t goal, uint8_t workers);
+
+extern const char *maze_kind_name(enum maze_kind kind);
+
+extern void print_maze_analysis(const maze_analysis_t *analysis);
+
+#endif
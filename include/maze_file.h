@@ -0,0 +1,104 @@
+#ifndef MAZE_FILE_H
+#define MAZE_FILE_H
+
+#include "maze.h"
+
+// On-disk maze format:
+// a 64 byte header followed by the cells, row by row, packed at 4 bits
+// per cell (the open directions <WSEN>). Even columns use the low nibble
+// and odd columns the high nibble, every row starts on a new byte.
+
+#define MAZE_FILE_MAGIC "CMZ\x01"
+#define MAZE_FILE_VERSION 1
+
+// header flags
+#define MAZE_FILE_HASHED 1      // hash holds the hash of the cell data
+
+// generators recorded in the header
+enum maze_generator {
+    MAZE_GENERATOR_UNKNOWN = 0,
+    MAZE_GENERATOR_MCMC,
+    MAZE_GENERATOR_MCMC_PARALLEL,
+    MAZE_GENERATOR_HILBERT,
+    MAZE_GENERATOR_ELLER,
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t dim_x, dim_y;
+    uint32_t generator;         // enum maze_generator
+    uint32_t flags;
+    uint64_t seed;
+    uint64_t hash;              // see maze_file_row_hash
+    uint64_t row_bytes;
+    uint8_t reserved[8];
+} maze_file_header_t;
+
+// what the header says about where the maze came from
+typedef struct {
+    uint32_t generator;
+    uint64_t seed;
+} maze_file_info_t;
+
+// read only view of a memory mapped maze file, cells stay packed
+typedef struct {
+    const maze_file_header_t *header;
+    const uint8_t *cells;
+    vec2_t dimensions;
+    size_t row_bytes;
+    void *mapping;
+    size_t mapping_size;
+} maze_file_t;
+
+// open directions of a cell in a mapped file
+#define maze_file_at(file,_x,_y) \
+    (((file).cells[(size_t)(_y)*(file).row_bytes + ((_x)>>1)] >> (((_x)&1)<<2)) & 0xF)
+
+// bytes of packed rows the writer gathers before writing them
+#define MAZE_FILE_WRITE_CHUNK (1<<20)
+
+// row by row writer, so mazes can be streamed to disk (or to a pipe)
+// without being held in memory
+typedef struct {
+    int fd;
+    maze_file_header_t header;
+    uint8_t *buffer;            // packed rows not written yet
+    uint64_t buffer_rows, buffered_rows;
+    uint64_t rows_written;
+    uint64_t hash;
+} maze_file_writer_t;
+
+// starts a maze file on fd, the header is written right away
+extern void begin_maze_file(maze_file_writer_t *writer, int fd, uint64_t dim_x, uint64_t dim_y, maze_file_info_t info);
+
+// packs and writes the next row, dim_x cells
+extern void write_maze_file_row(maze_file_writer_t *writer, const maze_vertex_t *row);
+
+// writes an already packed row of header.row_bytes bytes
+extern void write_maze_file_packed_row(maze_file_writer_t *writer, const uint8_t *packed_row);
+
+// finishes the file, the hash is stored in the header when fd is seekable
+extern void end_maze_file(maze_file_writer_t *writer);
+
+// writes the whole maze to path
+extern void write_maze_file(maze_t maze, const char *path, maze_file_info_t info);
+
+// streams a maze made with Eller's algorithm to fd, one row at a time:
+// memory stays O(dim_x) whatever dim_y, so the maze can be bigger than
+// memory. The hash is only stored if fd is seekable
+extern void write_maze_file_eller(int fd, int_t dim_x, uint64_t dim_y, uint64_t seed);
+
+// maps a maze file without copying it, see maze_file_at
+extern maze_file_t map_maze_file(const char *path);
+
+extern void unmap_maze_file(maze_file_t *file);
+
+// checks the stored hash against the cells, files without a hash pass
+extern bool verify_maze_file(maze_file_t file, uint8_t workers);
+
+// maps a maze file and unpacks it in parallel into a newly allocated maze,
+// checking the hash on the way. info may be NULL
+extern maze_t load_maze_file(const char *path, maze_file_info_t *info, uint8_t workers);
+
+#endif
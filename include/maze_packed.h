@@ -0,0 +1,72 @@
+#ifndef MAZE_PACKED_H
+#define MAZE_PACKED_H
+
+#include "maze.h"
+
+// Compact maze representations. In maze_t every passage is stored twice
+// (the EAST of a cell is the WEST of its neighbour), these keep each
+// passage once or lay the directions out for word wide operations.
+
+
+// 2 bits per cell: bit 0 is EAST open, bit 1 is SOUTH open. NORTH and
+// WEST are read from the cells above and to the left. Four cells per
+// byte, every row starts on a new byte
+typedef struct {
+    uint8_t *data;
+    vec2_t dimensions;
+    size_t row_bytes;
+} packed_maze_t;
+
+#define PACKED_EAST 1
+#define PACKED_SOUTH 2
+
+// the 2 bit east/south field of a cell
+#define packed_maze_bits(maze,_x,_y) \
+    (((maze).data[(size_t)(_y)*(maze).row_bytes + ((_x)>>2)] >> (((_x)&3)<<1)) & 3)
+
+// open directions of a cell, <WSEN> like maze_vertex_t
+static inline direction_t packed_maze_open_directions(packed_maze_t maze, int_t x, int_t y){
+    uint8_t bits = packed_maze_bits(maze,x,y);
+    direction_t open = ((bits & PACKED_EAST) ? EAST : 0) | ((bits & PACKED_SOUTH) ? SOUTH : 0);
+    if(x > 0 && (packed_maze_bits(maze,x-1,y) & PACKED_EAST)) open |= WEST;
+    if(y > 0 && (packed_maze_bits(maze,x,y-1) & PACKED_SOUTH)) open |= NORTH;
+    return open;
+}
+
+
+// one bit per cell for each direction, 64 cells per word. Bit x%64 of
+// word x/64 of a row is cell x, every row starts on a new word
+enum bitplane { PLANE_NORTH, PLANE_EAST, PLANE_SOUTH, PLANE_WEST, NUMBER_OF_PLANES };
+
+typedef struct {
+    uint64_t *planes[NUMBER_OF_PLANES];
+    vec2_t dimensions;
+    size_t row_words;
+} bitplane_maze_t;
+
+// word w of row y in a plane
+#define bitplane_word(maze,plane,_y,_w) ((maze).planes[plane][(size_t)(_y)*(maze).row_words + (_w)])
+
+static inline direction_t bitplane_maze_open_directions(bitplane_maze_t maze, int_t x, int_t y){
+    direction_t open = 0;
+    for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane)
+        open |= ((bitplane_word(maze,plane,y,x>>6) >> (x&63)) & 1) << plane;
+    return open;
+}
+
+
+extern packed_maze_t alloc_packed_maze(int_t dim_x, int_t dim_y);
+extern void free_packed_maze(packed_maze_t *maze);
+
+extern bitplane_maze_t alloc_bitplane_maze(int_t dim_x, int_t dim_y);
+extern void free_bitplane_maze(bitplane_maze_t *maze);
+
+// conversions, each worker converts a band of rows.
+// The *_to_maze conversions allocate the maze_t
+extern packed_maze_t maze_to_packed(maze_t maze, uint8_t workers);
+extern maze_t packed_to_maze(packed_maze_t packed, uint8_t workers);
+
+extern bitplane_maze_t maze_to_bitplanes(maze_t maze, uint8_t workers);
+extern maze_t bitplanes_to_maze(bitplane_maze_t bitplanes, uint8_t workers);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include "maze.h"
+
+// The spanning tree of a perfect maze as parent pointers, with the depth
+// of every cell below the root. The path between two cells goes up from
+// both to their lowest common ancestor, so any start/goal query is
+// answered by walking up the tree, without searching the maze.
+//
+// The parents are 2 bits per cell, the log2 of the direction towards the
+// parent (0 NORTH, 1 EAST, 2 SOUTH, 3 WEST), four cells per byte in cell
+// order: the layout of the MCMC blueprint, which is handed over as is.
+// The bits of the root are meaningless.
+typedef struct {
+    uint8_t *parents;
+    uint32_t *depth;
+    int_t dim_x, dim_y;
+    index_t root;
+} path_index_t;
+
+#define path_index_parent(index,_i) (((index).parents[(_i)>>2] >> (((_i)&3)<<1)) & 3)
+
+// cell one step from cell i towards direction code (log2 of the direction)
+static inline index_t path_index_step(const path_index_t *index, index_t i, uint8_t code){
+    switch(code){
+        case 0: return i - index->dim_x;
+        case 1: return i + 1;
+        case 2: return i + index->dim_x;
+        default: return i - 1;
+    }
+}
+
+// zeroed parents for a dim_x x dim_y maze, no depths yet
+extern void alloc_path_index(path_index_t *index, int_t dim_x, int_t dim_y);
+
+extern void free_path_index(path_index_t *index);
+
+// fills the depths from the parents and the root
+extern void path_index_depths(path_index_t *index);
+
+// the index of any perfect maze rooted at root, found by walking the maze.
+// In a maze with loops it is a spanning tree and the paths it gives are
+// not the shortest
+extern path_index_t path_index_from_maze(maze_t maze, index_t root);
+
+// lowest common ancestor of cells a and b (x + y*dim_x)
+extern index_t path_index_ancestor(const path_index_t *index, index_t a, index_t b);
+
+// number of steps between cells a and b
+extern index_t path_index_distance(const path_index_t *index, index_t a, index_t b);
+
+// writes the cells from a to b, both included, in path (distance+1 of
+// them) and returns the distance. path can be NULL
+extern index_t path_index_path(const path_index_t *index, index_t a, index_t b, index_t *path);
+
+
+// Constant time queries on a perfect maze: the lowest common ancestor of
+// any two cells is a range minimum over the depth first preorder of the
+// tree, answered with a sparse table over blocks of the preorder and a
+// bitmask per position inside the blocks. About 20 bytes per cell on top
+// of the tree.
+typedef struct {
+    path_index_t tree;          // rooted at cell 0
+    uint32_t *order;            // the cells in depth first preorder
+    uint32_t *preorder;         // position of every cell in order
+    uint32_t *order_depth;      // depth of order[i]
+    uint64_t *masks;            // minima inside the block of every position
+    uint32_t *table;            // shallowest position of 2^level blocks, by level
+    uint64_t blocks, levels;
+} lca_index_t;
+
+// builds the index of maze with workers threads. Returns false, with
+// nothing to free, if the maze isn't a tree: it has loops, parts that
+// can't be reached or passages open on one side only
+extern bool build_lca_index(maze_t maze, uint8_t workers, lca_index_t *index);
+
+extern void free_lca_index(lca_index_t *index);
+
+// lowest common ancestor of cells a and b, in constant time
+extern index_t lca_index_ancestor(const lca_index_t *index, index_t a, index_t b);
+
+// number of steps between cells a and b, in constant time
+extern index_t lca_index_distance(const lca_index_t *index, index_t a, index_t b);
+
+// like path_index_path, in time of the length of the path
+extern index_t lca_index_path(const lca_index_t *index, index_t a, index_t b, index_t *path);
+
+
+// the generators that build the tree on the way hand it over in *index
+// (see generate_random_maze_MCMC, generate_random_maze_hillbert_lookahead
+// and generate_random_maze_gilbert_lookahead)
+extern maze_t generate_random_maze_MCMC_indexed(int_t dim_x, int_t dim_y, uint64_t number_of_iterations,
+                                                uint64_t seed, path_index_t *index);
+extern maze_t generate_random_maze_hillbert_lookahead_indexed(uint64_t side, uint8_t workers, uint64_t seed,
+                                                             path_index_t *index);
+extern maze_t generate_random_maze_gilbert_lookahead_indexed(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed,
+                                                             path_index_t *index);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "maze.h"
+
+// Small, fast random number generator (xoshiro256**) for the generators.
+// Each thread owns its state, so unlike rand() there is no shared lock
+// and parallel generators don't step on each other.
+typedef struct {
+    uint64_t s[4];
+} random_t;
+
+// splitmix64, expands a 64 bit seed into well mixed state words
+static inline uint64_t splitmix64(uint64_t *x){
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// splitmix64 finalizer, a bijective mix of the 64 bits
+static inline uint64_t mix64(uint64_t z){
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// counter based random number: the same (seed,key) always gives the same
+// number, whatever thread asks for it or in which order. Keys are cells,
+// tiles, boundaries...
+static inline uint64_t keyed_random(uint64_t seed, uint64_t key){
+    return mix64(seed ^ mix64(key + 0x9e3779b97f4a7c15ULL));
+}
+
+static inline void seed_random(random_t *random, uint64_t seed){
+    for(int i = 0 ; i < 4 ; ++i)
+        random->s[i] = splitmix64(&seed);
+}
+
+// independent generator for each key (e.g. one per tile) of a seed
+static inline void seed_random_stream(random_t *random, uint64_t seed, uint64_t key){
+    seed_random(random,keyed_random(seed,key));
+}
+
+static inline uint64_t random_rotl(uint64_t x, int k){
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t next_random(random_t *random){
+    uint64_t *s = random->s;
+    uint64_t result = random_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = random_rotl(s[3], 45);
+    return result;
+}
+
+// random number in [0,n), multiply-shift instead of a division
+static inline uint32_t random_below(random_t *random, uint32_t n){
+    return (uint32_t)(((next_random(random) >> 32) * n) >> 32);
+}
+
+// random_direction_table[available][i] for i in [0,12) is the
+// (i % number of available)-th available direction, 12 being a multiple
+// of 1, 2, 3 and 4, so any uniform i gives a uniform direction
+extern const direction_t random_direction_table[16][12];
+
+// uniformly chosen direction among the available ones, without branches
+static inline direction_t fast_random_direction(random_t *random, direction_t available){
+    return random_direction_table[available][random_below(random,12)];
+}
+
+// the same choice as fast_random_direction, from a keyed random number
+static inline direction_t keyed_random_direction(uint64_t seed, uint64_t key, direction_t available){
+    return random_direction_table[available][((keyed_random(seed,key) >> 32)*12) >> 32];
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "maze.h"
 #include "common.h"
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -18,20 +19,21 @@ typedef struct {
 typedef struct {
     bool *data;                 // Color
     direction_t *explored_from; // Direction from which each cell was explored (0 if not explored)
+    uint8_t *explored_by;       // Worker that explored each cell
     vec2_t dimensions;          
     vec2_t true_dimensions;     
-    int_t start;                
+    index_t start;              
     mutex_grid_t mutex_grid;    // Grid of mutexes
 } exploration_map_t;
 
 // Macro to access exploration map
 #define explored_at(exp_map, _x, _y) \
-    ((exp_map).data[(exp_map).start + (_x) + (_y) * (exp_map).true_dimensions.x])
+    ((exp_map).data[(exp_map).start + (_x) + (index_t)(_y) * (exp_map).true_dimensions.x])
 
 // Get the mutex index for a given position
 #define get_mutex_index(exp_map, _x, _y) \
     (((_x) / (exp_map).mutex_grid.region_size) + \
-     ((_y) / (exp_map).mutex_grid.region_size) * (exp_map).mutex_grid.grid_dimensions.x)
+     (index_t)((_y) / (exp_map).mutex_grid.region_size) * (exp_map).mutex_grid.grid_dimensions.x)
 
 // Bifurcation (position to explore)
 typedef struct {
@@ -42,20 +44,29 @@ typedef struct {
 // Thread-safe buffer for bifurcations to be explored
 typedef struct {
     bifurcation_t *data;        // Array of bifurcations
-    int_t capacity;             // Maximum capacity
-    int_t head;                 // Index where we read from (FIFO)
-    int_t tail;                 // Index where we write to (FIFO)
-    int_t count;                // Current number of elements
+    index_t capacity;           // Maximum capacity
+    index_t head;               // Index where we read from (FIFO)
+    index_t tail;               // Index where we write to (FIFO)
+    index_t count;              // Current number of elements
     pthread_mutex_t mutex;      // Mutex for thread safety and coordination
     pthread_cond_t work_available; // Condition for work availability or termination
 } bifurcation_buffer_t;
 
-// Worker position tracking
+// Worker position tracking, published through a per-worker seqlock so the
+// visualizer can read it without ever blocking the worker
 typedef struct {
-    vec2_t position;            // Current position of the worker
-    bool is_active;             // Whether worker is actively exploring
+    _Alignas(64) atomic_uint sequence; // Odd while the worker is updating the slot
+    _Atomic int_t x, y;         // Current position of the worker
+    atomic_bool is_active;      // Whether worker is actively exploring
 } worker_position_t;
 
+// Solution path, traced back from the goal once per solve for the viewports
+typedef struct {
+    uint8_t *cells;             // One bit per maze cell, set on the path (NULL until traced)
+    uint64_t length;            // Cells on the path, start and goal included
+    vec2_t middle;              // Middle cell of the path
+} solution_path_t;
+
 // Shared state for all solver threads
 typedef struct {
     maze_t maze;                        // The maze to solve
@@ -67,9 +78,9 @@ typedef struct {
     int active_workers;                 // Number of currently active workers
     bool shutdown;                      // Flag to signal all threads to terminate
     worker_position_t *worker_positions; // Array of worker positions for visualization
-    pthread_mutex_t viz_mutex;          // Mutex for visualization updates
     bool enable_visualization;          // Enable real-time visualization
     uint32_t speed;
+    solution_path_t solution_path;      // Traced on first use by the visualization
 } solver_state_t;
 
 // Arguments passed to each worker thread
@@ -106,6 +117,10 @@ void cleanup_solver_state(solver_state_t *state);
 // SOLVER FUNCTIONS
 // ==============================================================================
 
+// Launches the worker threads on an initialized state and waits for them,
+// the state keeps the exploration results until cleanup_solver_state
+void run_solver(solver_state_t *state, uint32_t speed);
+
 // Main solver function - launches worker threads and solves the maze
 void solve_maze(maze_t maze, uint8_t num_workers, bool enable_viz, uint32_t speed);
 
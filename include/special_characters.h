@@ -5,9 +5,29 @@
 
 typedef wchar_t spchar_t;
 
+// a glyph already encoded in UTF-8, padded to 4 bytes so it can
+// be copied with a fixed size memcpy
+typedef struct {
+    char bytes[4];
+    uint8_t length;
+} utf8_glyph_t;
+
+// box glyphs indexed by open directions <WSEN>
+extern const utf8_glyph_t box_glyphs_utf8[16];
+
+// horizontal connectors indexed by whether both cells open towards each other
+extern const utf8_glyph_t connector_glyphs_utf8[2];
+
+#define connector_index(left_dirs, right_dirs) \
+    ((((left_dirs) & EAST) >> 1) & (((right_dirs) & WEST) >> 3))
+
 spchar_t get_box_char(direction_t dirs);
 
 void print_spchar(spchar_t ch);
 
+// encodes a special character as UTF-8 into out (at least 4 bytes),
+// returns the number of bytes written
+size_t spchar_to_utf8(spchar_t ch, char *out);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include "common.h"
+
+// Work stealing pool for recursive, fork-join style work: every worker has
+// its own deque of tasks, pushes and pops at its bottom and, when it runs
+// out, steals the oldest task (the biggest piece of work, for recursive
+// splits) from the top of another worker's deque. The pool ends when no
+// task is left anywhere.
+
+// bytes of arguments a task carries with it
+#define TASK_PAYLOAD_SIZE 64
+
+typedef struct task_pool task_pool_t;
+
+// a task gets the pool to spawn more tasks on, its own payload and the
+// worker running it
+typedef void (*task_function_t)(task_pool_t *pool, void *payload, uint8_t worker);
+
+// queues a task on the deque of worker, size bytes of payload are copied
+extern void task_pool_spawn(task_pool_t *pool, uint8_t worker, task_function_t function,
+                            const void *payload, size_t size);
+
+// runs function(payload) and everything it spawns on workers pinned
+// threads, returns when all of it is done
+extern void task_pool_run(uint8_t workers, task_function_t function, const void *payload, size_t size);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TILED_MAZE_H
+#define TILED_MAZE_H
+
+#include "maze.h"
+
+// Out-of-core maze: the cells live in a file as square tiles (tile after
+// tile, row major inside each tile) and only a bounded number of tiles is
+// kept in memory, evicting the least recently used one. Dirty tiles are
+// written back when evicted or flushed. Not thread safe.
+
+typedef struct {
+    uint64_t tile;              // tile held by the slot, UINT64_MAX when empty
+    int32_t prev, next;         // LRU list, head is the most recently used
+    bool dirty;
+} tile_slot_t;
+
+typedef struct {
+    int fd;
+    vec2_t dimensions;
+    vec2_t tiles;               // number of tiles in each direction
+    uint8_t tile_shift;         // tiles are (1<<tile_shift) cells wide
+    size_t tile_cells;
+
+    maze_vertex_t *slots;       // cache_tiles * tile_cells cells
+    tile_slot_t *slot_info;
+    int32_t *tile_to_slot;      // -1 when the tile isn't cached
+    int32_t cache_tiles;
+    int32_t lru_head, lru_tail;
+
+    // last accessed tile, accesses inside it skip the lookup
+    uint64_t last_tile;
+    maze_vertex_t *last_data;
+    bool last_dirty;
+
+    uint64_t hits, misses, evictions;
+} tiled_maze_t;
+
+// creates the backing file (every cell starts closed, like alloc_maze).
+// tile_side must be a power of two, at most cache_bytes of cells are kept
+// in memory (at least 4 tiles)
+extern tiled_maze_t create_tiled_maze(const char *path, int_t dim_x, int_t dim_y, int_t tile_side, size_t cache_bytes);
+
+// writes back every dirty tile
+extern void flush_tiled_maze(tiled_maze_t *maze);
+
+// flushes and frees the cache, the file is kept
+extern void close_tiled_maze(tiled_maze_t *maze);
+
+// loads a tile into the cache (evicting if needed) and makes it the last
+// accessed tile
+extern void tiled_maze_fault(tiled_maze_t *maze, uint64_t tile, bool write);
+
+static inline maze_vertex_t *tiled_maze_cell(tiled_maze_t *maze, int_t x, int_t y, bool write){
+    uint64_t tile = (uint64_t)(y >> maze->tile_shift)*maze->tiles.x + (x >> maze->tile_shift);
+    if(tile != maze->last_tile || (write && !maze->last_dirty))
+        tiled_maze_fault(maze,tile,write);
+    int_t mask = (1u << maze->tile_shift) - 1;
+    return maze->last_data + (((size_t)(y & mask)) << maze->tile_shift) + (x & mask);
+}
+
+// maze_at for tiled mazes, the tile is marked dirty.
+// The cell is only valid until another tile is accessed
+#define tiled_maze_at(maze,_x,_y) (*tiled_maze_cell(&(maze),(_x),(_y),true))
+
+// read only access, the tile is not written back because of it
+#define tiled_maze_get(maze,_x,_y) (*tiled_maze_cell(&(maze),(_x),(_y),false))
+
+// streams the tiled maze row by row into a maze file (see maze_file.h)
+extern void write_tiled_maze_file(tiled_maze_t *maze, const char *path);
+
+
+// generates a random maze directly in a tiled maze with a depth first
+// backtracker. The way back is kept in the upper nibble of every cell,
+// so no memory other than the tile cache is needed
+extern tiled_maze_t generate_random_maze_tiled(const char *path, int_t dim_x, int_t dim_y, int_t tile_side, size_t cache_bytes, uint64_t seed);
+
+typedef struct {
+    bool found;
+    uint64_t path_length;       // cells in the solution, start and goal included
+    uint64_t explored;          // cells visited by the search
+} tiled_solution_t;
+
+// depth first search from (0,0) to the opposite corner, also keeping the
+// way back in the upper nibble of the cells, which are cleared at the end
+extern tiled_solution_t solve_tiled_maze(tiled_maze_t *maze);
+
+#endif
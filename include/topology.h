@@ -0,0 +1,55 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "common.h"
+
+// CPUs this process may run on (sched_getaffinity) and the NUMA node
+// of each one (/sys/devices/system/node), detected once on first use.
+// Without sysfs every CPU is taken to be on node 0.
+typedef struct {
+    int number_of_cpus;
+    int *cpus;                  // allowed CPUs, sorted by node and then id
+    int *node_of_cpu;           // node of cpus[i]
+    int number_of_nodes;
+} topology_t;
+
+extern const topology_t *get_topology(void);
+
+// how worker threads are placed on the CPUs
+enum pinning_policy {
+    PIN_NONE,                   // leave placement to the OS
+    PIN_COMPACT,                // fill a node before moving to the next
+    PIN_SCATTER,                // round robin over the nodes
+};
+
+// the policy starts as MAZE_PINNING=none|compact|scatter from the
+// environment, none if unset
+extern enum pinning_policy get_pinning_policy(void);
+extern void set_pinning_policy(enum pinning_policy policy);
+
+// CPU worker worker_id of workers runs on under the policy, -1 for PIN_NONE
+extern int cpu_for_worker(enum pinning_policy policy, uint8_t worker_id, uint8_t workers);
+
+// pins the calling thread to its CPU under the current policy, every
+// parallel part of the solver and the generators calls this first so a
+// worker always lands on the same CPU (and node)
+extern void pin_worker(uint8_t worker_id, uint8_t workers);
+
+// runs band(first, last, arg) on workers threads pinned like the workers of
+// a parallel part, worker i taking the i-th of workers equal bands of
+// [0, count). A band that gets no thread is run by the caller
+extern void run_pinned_bands(uint8_t workers, uint64_t count,
+                             void (*band)(uint64_t first, uint64_t last, void *arg), void *arg);
+
+// transparent huge pages are placed whole on the node of the first thread
+// that touches them, alloc_cells aligns big arrays on them
+#define HUGE_PAGE_SIZE ((size_t)2<<20)
+
+// zeroes memory, worker i of workers touching the i-th band of pages first
+// so its pages are placed on the node worker i is pinned to. Bands are cut
+// at huge pages when data is aligned on one, at pages otherwise. Row bands
+// of the data then live with the workers that take the same bands. Under
+// PIN_NONE there is no node to aim for and it is a plain memset
+extern void first_touch(void *data, size_t bytes, uint8_t workers);
+
+#endif
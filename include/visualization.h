@@ -4,6 +4,22 @@
 #include "solver.h"
 #include <wchar.h>
 
+// Upper bound on animation frames per second, independent of the worker speed
+#define VIZ_MAX_FPS 30
+
+// Keeps what was drawn on the last frame so only changed cells are redrawn
+typedef struct {
+    uint8_t *previous;          // Cell state drawn on the previous frame (one per cell)
+    uint8_t *current;           // Cell states of the row being composed
+    uint8_t *worker_grid;       // Position -> worker color + 1 for the current snapshot (0 = none)
+    size_t *marked_cells;       // Cells set in worker_grid, one per worker (SIZE_MAX = none)
+    char *buffer;               // Whole frame, UTF-8 encoded
+    size_t length;              // Bytes used in buffer
+    size_t capacity;            // Bytes allocated for buffer
+    int style;                  // Last SGR style emitted into the buffer
+    bool first_frame;           // Forces a full redraw
+} frame_renderer_t;
+
 // Update worker visualization state (marks worker as active at given position)
 void mark_worker_active_at_position(solver_state_t *state, uint8_t worker_id, vec2_t position);
 
@@ -13,14 +29,57 @@ void mark_worker_inactive(solver_state_t *state, uint8_t worker_id);
 // Update worker position (keeping active state)
 void update_worker_position(solver_state_t *state, uint8_t worker_id, vec2_t position);
 
+// Reads a consistent copy of a worker position without blocking the worker,
+// returns whether the worker is active
+bool read_worker_position(solver_state_t *state, uint8_t worker_id, vec2_t *position);
+
+// Traces the solution path back from the goal on the first call of a solve,
+// later calls (every viewport of every frame, the image export) reuse it.
+// Not thread safe, trace it before handing the state to other threads
+solution_path_t *traced_solution(solver_state_t *state);
+
+// Whether cell (_x, _y) of maze is on a traced solution path
+#define on_solution_at(path, maze, _x, _y) \
+    (((path)->cells[((_x) + (index_t)(_y) * (maze).dimensions.x) / 8] >> \
+      (((_x) + (index_t)(_y) * (maze).dimensions.x) % 8)) & 1)
+
 // Print maze with exploration information (shows which cells were explored)
 void print_maze_explored(solver_state_t *state);
 
 // Print maze with solution path highlighted (traces path from start to goal)
 void print_maze_with_solution(solver_state_t *state);
 
-// Print maze with live worker positions (for animation)
-void print_maze_animated(solver_state_t *state);
+// Same as above, restricted to a window of the maze
+void print_maze_explored_viewport(solver_state_t *state, viewport_t view);
+void print_maze_with_solution_viewport(solver_state_t *state, viewport_t view);
+
+// Print a downsampled overview that fits in size (characters): every
+// braille glyph packs 2x4 dots and every dot stands for a block of cells,
+// lit when most of a fixed sample of its cells was explored. The solution
+// path, start and goal are colored. The cost depends on size, not on the maze
+void print_maze_overview(solver_state_t *state, vec2_t size);
+
+// Terminal size in characters, (0, 0) when stdout is not a terminal
+vec2_t terminal_size(void);
+
+// Largest viewport (in cells) that fits in a terminal of the given size
+vec2_t viewport_size_for_terminal(vec2_t terminal);
+
+// Viewports of the given size (in cells), clamped to the maze
+viewport_t viewport_around_goal(solver_state_t *state, vec2_t size);
+viewport_t viewport_around_worker(solver_state_t *state, uint8_t worker_id, vec2_t size);
+viewport_t viewport_around_solution(solver_state_t *state, vec2_t size);
+
+// Allocates a renderer for animating the given maze
+void init_frame_renderer(frame_renderer_t *renderer, maze_t maze, uint8_t num_workers);
+
+// Frees the renderer buffers
+void free_frame_renderer(frame_renderer_t *renderer);
+
+// Print maze with live worker positions (for animation). Composes the frame
+// in the renderer buffer, only redrawing cells that changed since the last
+// frame, and writes it to stdout with a single write(2)
+void print_maze_animated(solver_state_t *state, frame_renderer_t *renderer);
 
 // Visualization thread function (runs continuously during solving)
 void* visualizer_thread(void *args);
@@ -0,0 +1,184 @@
+#include "image_export.h"
+#include "visualization.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    uint8_t r, g, b;
+} rgb_t;
+
+static const rgb_t WALL_COLOR       = {0x20, 0x20, 0x20};
+static const rgb_t UNEXPLORED_COLOR = {0xFF, 0xFF, 0xFF};
+static const rgb_t PATH_COLOR       = {0xFF, 0xC8, 0x00};
+static const rgb_t START_COLOR      = {0x00, 0xC0, 0x00};
+static const rgb_t GOAL_COLOR       = {0xE0, 0x00, 0x00};
+
+// Colors for the explored cells, indexed by worker
+static const rgb_t worker_colors[] = {
+    {0xF4, 0xA6, 0xF0},
+    {0x9E, 0xE6, 0xF0},
+    {0xF4, 0xE8, 0x9A},
+    {0xA8, 0xEC, 0xA0},
+    {0xA4, 0xB8, 0xF4},
+    {0xF4, 0xA8, 0xA0},
+    {0xC8, 0x9C, 0xE0},
+    {0x8C, 0xD0, 0xC4},
+};
+#define NUM_WORKER_COLORS 8
+
+typedef struct {
+    maze_t maze;
+    solver_state_t *state;      // may be NULL
+    solution_path_t *path;      // NULL without a solution
+    int fd;
+    size_t header_size;
+    size_t row_bytes;
+    uint64_t height;            // in pixels
+    atomic_uint_fast64_t next_band;
+} image_export_t;
+
+typedef struct {
+    image_export_t *export;
+} export_worker_args_t;
+
+// What a cell is drawn as: its color and whether it belongs to the path
+typedef struct {
+    rgb_t color;
+    bool on_path;
+} cell_paint_t;
+
+static cell_paint_t paint_cell(image_export_t *export, int_t x, int_t y) {
+    if (!export->state) return (cell_paint_t){UNEXPLORED_COLOR, false};
+    solver_state_t *state = export->state;
+    exploration_map_t *exp = &state->explored;
+    
+    if (x == 0 && y == 0) return (cell_paint_t){START_COLOR, true};
+    if (x == state->goal.x && y == state->goal.y) return (cell_paint_t){GOAL_COLOR, true};
+    size_t idx = exp->start + x + (size_t)y * exp->true_dimensions.x;
+    if (export->path && on_solution_at(export->path, state->maze, x, y)) return (cell_paint_t){PATH_COLOR, true};
+    if (!exp->data[idx]) return (cell_paint_t){UNEXPLORED_COLOR, false};
+    return (cell_paint_t){worker_colors[exp->explored_by[idx] % NUM_WORKER_COLORS], false};
+}
+
+// A passage is part of the path only when both of its ends are, otherwise
+// it takes the color of the end that is not on the path
+static rgb_t passage_color(cell_paint_t here, cell_paint_t next) {
+    if (here.on_path && next.on_path) return PATH_COLOR;
+    if (here.on_path) return next.color;
+    return here.color;
+}
+
+static inline uint8_t *put_pixel(uint8_t *out, rgb_t color) {
+    out[0] = color.r;
+    out[1] = color.g;
+    out[2] = color.b;
+    return out + 3;
+}
+
+// Pixel row 0 is the top wall, then odd rows hold cells and east passages
+// and even rows hold south passages and wall corners
+static void render_pixel_row(image_export_t *export, uint64_t pixel_y, uint8_t *out) {
+    maze_t maze = export->maze;
+    if (pixel_y == 0) {
+        for (uint64_t px = 0; px < 2 * (uint64_t)maze.dimensions.x + 1; px++) {
+            out = put_pixel(out, WALL_COLOR);
+        }
+        return;
+    }
+    int_t y = (pixel_y - 1) / 2;
+    bool cell_row = (pixel_y - 1) % 2 == 0;
+    
+    out = put_pixel(out, WALL_COLOR);
+    cell_paint_t here = paint_cell(export, 0, y);
+    for (int_t x = 0; x < maze.dimensions.x; x++) {
+        direction_t open = maze_at(maze, x, y).open_directions;
+        if (cell_row) {
+            out = put_pixel(out, here.color);
+            cell_paint_t east = x + 1 < maze.dimensions.x ? paint_cell(export, x + 1, y) : here;
+            out = put_pixel(out, (open & EAST) && x + 1 < maze.dimensions.x ?
+                                 passage_color(here, east) : WALL_COLOR);
+            here = east;
+        } else {
+            if ((open & SOUTH) && y + 1 < maze.dimensions.y) {
+                out = put_pixel(out, passage_color(paint_cell(export, x, y), paint_cell(export, x, y + 1)));
+            } else {
+                out = put_pixel(out, WALL_COLOR);
+            }
+            out = put_pixel(out, WALL_COLOR);
+        }
+    }
+}
+
+static void* export_worker(void *void_args) {
+    image_export_t *export = ((export_worker_args_t*) void_args)->export;
+    
+    uint8_t *band = (uint8_t*) malloc(export->row_bytes * EXPORT_BAND_ROWS);
+    if (!band) PERROR("Couldn't allocate image band of %d rows", EXPORT_BAND_ROWS);
+    
+    while (true) {
+        uint64_t band_index = atomic_fetch_add(&export->next_band, 1);
+        uint64_t first_row = band_index * EXPORT_BAND_ROWS;
+        if (first_row >= export->height) break;
+        uint64_t rows = export->height - first_row;
+        if (rows > EXPORT_BAND_ROWS) rows = EXPORT_BAND_ROWS;
+        
+        for (uint64_t r = 0; r < rows; r++) {
+            render_pixel_row(export, first_row + r, band + r * export->row_bytes);
+        }
+        
+        // bands have a fixed place in the file, no need to write them in order
+        size_t remaining = rows * export->row_bytes;
+        off_t offset = export->header_size + first_row * export->row_bytes;
+        uint8_t *bytes = band;
+        while (remaining > 0) {
+            ssize_t written = pwrite(export->fd, bytes, remaining, offset);
+            if (written <= 0) PERROR("Couldn't write image band at row %lu", (unsigned long)first_row);
+            bytes += written;
+            offset += written;
+            remaining -= written;
+        }
+    }
+    
+    free(band);
+    return NULL;
+}
+
+void export_maze_image(maze_t maze, solver_state_t *state, const char *path, uint8_t workers) {
+    if (workers < 1) workers = 1;
+    
+    image_export_t export;
+    export.maze = maze;
+    export.state = state;
+    // the path cached by the solve, traced here if nothing was shown yet
+    export.path = (state && state->solution_found) ? traced_solution(state) : NULL;
+    
+    uint64_t width = 2 * (uint64_t)maze.dimensions.x + 1;
+    export.height = 2 * (uint64_t)maze.dimensions.y + 1;
+    export.row_bytes = width * 3;
+    atomic_init(&export.next_band, 0);
+    
+    char header[64];
+    export.header_size = snprintf(header, sizeof(header), "P6\n%lu %lu\n255\n",
+                                  (unsigned long)width, (unsigned long)export.height);
+    
+    export.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (export.fd < 0) PERROR("Couldn't open %s to export the maze image", path);
+    if (ftruncate(export.fd, export.header_size + export.height * export.row_bytes) != 0)
+        PERROR("Couldn't reserve space for the maze image in %s", path);
+    if (pwrite(export.fd, header, export.header_size, 0) != (ssize_t)export.header_size)
+        PERROR("Couldn't write the image header to %s", path);
+    
+    pthread_t *tid = calloc(workers, sizeof(pthread_t));
+    if (!tid) PERROR("Couldn't allocate space for threads while exporting the maze image.");
+    export_worker_args_t args = {&export};
+    for (uint8_t i = 0; i < workers; ++i) {
+        pthread_create(&tid[i], NULL, export_worker, (void*)&args);
+    }
+    for (uint8_t i = 0; i < workers; ++i) {
+        pthread_join(tid[i], NULL);
+    }
+    
+    close(export.fd);
+    free(tid);
+}
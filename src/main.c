@@ -28,14 +28,24 @@ int main(int argc, char **argv) {
         enable_iterative_visualization = (atoi(argv[3]) != 0);
     }
     
+    // the same seed generates the same maze
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], NULL, 10) : (uint64_t)time(NULL);
+    
+    // fraction of the dead ends opened into loops, 0 keeps the maze perfect
+    double braid_fraction = (argc > 5) ? atof(argv[5]) : 0;
+    
     // Generate maze
-    wprintf(L"Generating %dx%d maze...\n", maze_side_size, maze_side_size);
-    uint64_t iterations = maze_side_size * maze_side_size * maze_side_size;
-    maze_t maze = generate_random_maze_MCMC(maze_side_size, maze_side_size, iterations);
+    wprintf(L"Generating %dx%d maze (seed %lu)...\n", maze_side_size, maze_side_size, (unsigned long)seed);
+    maze_t maze = generate_random_maze_wilson(maze_side_size, maze_side_size, seed);
+    if (braid_fraction > 0) {
+        index_t opened = braid_maze(maze, braid_fraction, num_workers, seed);
+        wprintf(L"Braided: %lu walls opened\n", (unsigned long)opened);
+    }
     wprintf(L"Maze generated!\n\n");
     
     // Solve the maze
-    solve_maze(maze, num_workers, enable_iterative_visualization);
+    uint32_t speed = enable_iterative_visualization ? 5000 : 0;
+    solve_maze(maze, num_workers, enable_iterative_visualization, speed);
     
     // Cleanup
     free(maze.data);
@@ -1,6 +1,11 @@
 #include "maze.h"
 #include "special_characters.h"
 #include "common.h"
+#include "topology.h"
+#include "random.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 
 void print_direction(direction_t direction){
@@ -32,11 +37,37 @@ void print_direction(direction_t direction){
 
 
 
+void *alloc_cells_for_workers(index_t count, size_t size, uint8_t workers){
+    size_t bytes = count*size;
+    if(bytes < HUGE_PAGE_SIZE)
+        return calloc(count,size);
+
+    void *cells;
+    bytes = (bytes + HUGE_PAGE_SIZE-1) & ~(HUGE_PAGE_SIZE-1);
+    if(posix_memalign(&cells,HUGE_PAGE_SIZE,bytes) != 0)
+        return NULL;
+    // only a hint, kernels without transparent huge pages ignore it
+    madvise(cells,bytes,MADV_HUGEPAGE);
+    // the pages land on the nodes of the workers that will use them
+    first_touch(cells,bytes,workers);
+    return cells;
+}
+
+void *alloc_cells(index_t count, size_t size){
+    return alloc_cells_for_workers(count,size,available_cores());
+}
+
+
+
 void alloc_maze(maze_t *maze,int_t dim_x, int_t dim_y){
+    alloc_maze_for_workers(maze,dim_x,dim_y,available_cores());
+}
+
+void alloc_maze_for_workers(maze_t *maze,int_t dim_x, int_t dim_y, uint8_t workers){
     maze->dimensions = (vec2_t){dim_x,dim_y};
     maze->true_dimensions = maze->dimensions;
     maze->start = 0;
-    maze->data = (maze_vertex_t*) calloc(dim_x*dim_y,sizeof(maze_vertex_t));
+    maze->data = (maze_vertex_t*) alloc_cells_for_workers((index_t)dim_x*dim_y,sizeof(maze_vertex_t),workers);
     if(!maze->data) 
         PERROR("Couldn\'t allocate space for the maze with size: %d x %d",dim_x,dim_y);
 
@@ -47,7 +78,7 @@ void alloc_maze(maze_t *maze,int_t dim_x, int_t dim_y){
 
 maze_t get_sub_maze(maze_t maze,int_t start_x,int_t start_y,int_t end_x,int_t end_y){
     maze_t sub = maze;
-    sub.start = maze.start + start_x + start_y*maze.true_dimensions.x;
+    sub.start = maze.start + start_x + (index_t)start_y*maze.true_dimensions.x;
     sub.dimensions.x = end_x - start_x;
     sub.dimensions.y = end_y - start_y;
     if(sub.dimensions.x<=0 || sub.dimensions.y<=0){
@@ -60,54 +91,116 @@ maze_t get_sub_maze(maze_t maze,int_t start_x,int_t start_y,int_t end_x,int_t en
 
 
 void print_maze(maze_t maze){
-    for(int y = 0 ; y < maze.dimensions.y ; ++y){
-        for(int x = 0 ; x < maze.dimensions.x ; ++x){
-            maze_vertex_t vertex = maze_at(maze,x,y);
-            spchar_t ch = get_box_char(vertex.open_directions);
-            
+    fflush(stdout);
+    write_maze(maze,STDOUT_FILENO);
+}
+
+
+
+// every row is built in a large buffer with fixed size copies from the
+// glyph tables, and the buffer goes out with a single write(2) when full
+#define MAZE_WRITE_BUFFER_SIZE (4<<20)
+static void write_buffer(int fd, const char *bytes, size_t count){
+    while(count > 0){
+        ssize_t written = write(fd,bytes,count);
+        if(written <= 0) PERROR("Couldn't write maze to file descriptor %d",fd);
+        bytes += written;
+        count -= written;
+    }
+}
+void write_maze(maze_t maze, int fd){
+    // at most two 3 byte glyphs per cell (connector and cell), a newline
+    // per row, plus the padding of the last 4 byte copy
+    size_t row_size = (size_t)maze.dimensions.x*2*3 + 1 + 4;
+    size_t capacity = (row_size > MAZE_WRITE_BUFFER_SIZE)?row_size:MAZE_WRITE_BUFFER_SIZE;
+    char *buffer = (char*) malloc(capacity);
+    if(!buffer) PERROR("Couldn't allocate buffer to write maze with size: %d x %d",maze.dimensions.x,maze.dimensions.y);
+
+    size_t length = 0;
+    for(int_t y = 0 ; y < maze.dimensions.y ; ++y){
+        if(length + row_size > capacity){
+            write_buffer(fd,buffer,length);
+            length = 0;
+        }
+        maze_vertex_t *row = &maze_at(maze,0,y);
+        direction_t left = 0;
+        for(int_t x = 0 ; x < maze.dimensions.x ; ++x){
+            direction_t dirs = row[x].open_directions & (NORTH|EAST|SOUTH|WEST);
             if(x>0){
-                
-                if((maze_at(maze,x-1,y).open_directions&EAST) && (maze_at(maze,x,y).open_directions&WEST)){
-                    spchar_t middle_ch = get_box_char(EAST|WEST);
-                    print_spchar(middle_ch);
-                }else{
-                    spchar_t middle_ch = get_box_char(0);
-                    print_spchar(middle_ch);
-                }
-                
+                const utf8_glyph_t *connector = &connector_glyphs_utf8[connector_index(left,dirs)];
+                memcpy(buffer+length,connector->bytes,4);
+                length += connector->length;
             }
-
-            print_spchar(ch);
+            const utf8_glyph_t *glyph = &box_glyphs_utf8[dirs];
+            memcpy(buffer+length,glyph->bytes,4);
+            length += glyph->length;
+            left = dirs;
         }
-        print_spchar(L'\n');
+        buffer[length++] = '\n';
     }
+    write_buffer(fd,buffer,length);
+    free(buffer);
+}
+
+
+
+void print_maze_viewport(maze_t maze, viewport_t view){
+    print_maze(get_sub_maze(maze,view.origin.x,view.origin.y,
+                            view.origin.x+view.size.x,view.origin.y+view.size.y));
 }
 
 
 
+viewport_t full_viewport(maze_t maze){
+    return (viewport_t){{0,0},maze.dimensions};
+}
+
+
+
+viewport_t viewport_around(maze_t maze, vec2_t center, vec2_t size){
+    viewport_t view;
+    view.size.x = (size.x < maze.dimensions.x)?size.x:maze.dimensions.x;
+    view.size.y = (size.y < maze.dimensions.y)?size.y:maze.dimensions.y;
+    if(view.size.x < 1) view.size.x = 1;
+    if(view.size.y < 1) view.size.y = 1;
+
+    // centre on the cell, then slide back inside the maze
+    view.origin.x = (center.x > view.size.x/2)?center.x - view.size.x/2:0;
+    view.origin.y = (center.y > view.size.y/2)?center.y - view.size.y/2:0;
+    if(view.origin.x + view.size.x > maze.dimensions.x) view.origin.x = maze.dimensions.x - view.size.x;
+    if(view.origin.y + view.size.y > maze.dimensions.y) view.origin.y = maze.dimensions.y - view.size.y;
+    return view;
+}
+
+
+
+// shared by random_direction and fast_random_direction (random.h)
+const direction_t random_direction_table[16][12] = {
+    {0,0,0,0,0,0,0,0,0,0,0,0},
+    {NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH,NORTH},
+    {EAST,EAST,EAST,EAST,EAST,EAST,EAST,EAST,EAST,EAST,EAST,EAST},
+    {NORTH,EAST,NORTH,EAST,NORTH,EAST,NORTH,EAST,NORTH,EAST,NORTH,EAST},
+    {SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH,SOUTH},
+    {NORTH,SOUTH,NORTH,SOUTH,NORTH,SOUTH,NORTH,SOUTH,NORTH,SOUTH,NORTH,SOUTH},
+    {EAST,SOUTH,EAST,SOUTH,EAST,SOUTH,EAST,SOUTH,EAST,SOUTH,EAST,SOUTH},
+    {NORTH,EAST,SOUTH,NORTH,EAST,SOUTH,NORTH,EAST,SOUTH,NORTH,EAST,SOUTH},
+    {WEST,WEST,WEST,WEST,WEST,WEST,WEST,WEST,WEST,WEST,WEST,WEST},
+    {NORTH,WEST,NORTH,WEST,NORTH,WEST,NORTH,WEST,NORTH,WEST,NORTH,WEST},
+    {EAST,WEST,EAST,WEST,EAST,WEST,EAST,WEST,EAST,WEST,EAST,WEST},
+    {NORTH,EAST,WEST,NORTH,EAST,WEST,NORTH,EAST,WEST,NORTH,EAST,WEST},
+    {SOUTH,WEST,SOUTH,WEST,SOUTH,WEST,SOUTH,WEST,SOUTH,WEST,SOUTH,WEST},
+    {NORTH,SOUTH,WEST,NORTH,SOUTH,WEST,NORTH,SOUTH,WEST,NORTH,SOUTH,WEST},
+    {EAST,SOUTH,WEST,EAST,SOUTH,WEST,EAST,SOUTH,WEST,EAST,SOUTH,WEST},
+    {NORTH,EAST,SOUTH,WEST,NORTH,EAST,SOUTH,WEST,NORTH,EAST,SOUTH,WEST},
+};
+
+
+
 direction_t random_direction(direction_t available){
-    uint8_t number_of_available_directions = ((available>>0)&1) + ((available>>1)&1) + ((available>>2)&1) + ((available>>3)&1);
-    uint8_t random = rand()%number_of_available_directions + 1; 
     // if there is 2 available directions, let's say East and West, available = <WSEN> = <1010>
-    // in this case, number of available directions is 2, so the random number is in {1, 2}
-    // If it's 1, the chosen direction is the first available from North to West, 
-    // so in this case, it's East: <0010>
-    // If it's 2, the chosen direction is the second available from North to West, 
-    // so in this case, it's West: <1000>
-
-    // The strategy is: start at North, and go towards West, whenever the bit in the direction
-    // I'm looking is also 1 in the available directions, then I check if my random number is 1
-    // If it's greater then 1, I lower it by one and continue, else I choose that direction
-    for(direction_t direction = NORTH; direction <= WEST; direction<<=1){
-        if(available&direction){
-            if(random == 1)
-                return direction;
-            else{
-                random --;
-            }
-        }
-    }
-    return available;
+    // and the row of the table is East,West,East,West... so a random
+    // number in [0,12) picks either with the same probability
+    return random_direction_table[available][rand()%12];
 }
 
 
@@ -177,4 +270,94 @@ void split_maze(maze_t maze ,maze_t *target,uint8_t parts){
     _recursive_split_maze(maze, target, parts);
     sort_sub_mazes(target,parts);
     free_slot = 0;
-}
\ No newline at end of file
+}
+
+
+
+maze_t *tile_maze(maze_t maze, int_t tile_side, vec2_t *grid){
+    grid->x = (maze.dimensions.x + tile_side-1)/tile_side;
+    grid->y = (maze.dimensions.y + tile_side-1)/tile_side;
+    maze_t *tiles = (maze_t*) calloc((size_t)grid->x*grid->y,sizeof(maze_t));
+    if(!tiles) PERROR("Couldn't allocate %u x %u tiles",grid->x,grid->y);
+
+    for(int_t y = 0 ; y < grid->y ; ++y){
+        for(int_t x = 0 ; x < grid->x ; ++x){
+            int_t end_x = (x+1)*tile_side < maze.dimensions.x ? (x+1)*tile_side : maze.dimensions.x;
+            int_t end_y = (y+1)*tile_side < maze.dimensions.y ? (y+1)*tile_side : maze.dimensions.y;
+            tiles[x + (size_t)y*grid->x] = get_sub_maze(maze,x*tile_side,y*tile_side,end_x,end_y);
+        }
+    }
+    return tiles;
+}
+
+
+
+// the spanning tree of the grid comes from a loop erased random walk
+// (Wilson's algorithm) over the tiles, so every tree is equally likely
+void glue_tiles(maze_t *tiles, vec2_t grid, uint64_t seed){
+    size_t number_of_tiles = (size_t)grid.x*grid.y;
+    if(number_of_tiles < 2) return;
+    direction_t *next = (direction_t*) calloc(number_of_tiles,sizeof(direction_t));
+    bool *in_tree = (bool*) calloc(number_of_tiles,sizeof(bool));
+    if(!next || !in_tree) PERROR("Couldn't allocate space to glue %lu tiles",(unsigned long)number_of_tiles);
+
+    random_t random;
+    seed_random(&random,seed);
+    in_tree[0] = true;
+    for(size_t first = 1 ; first < number_of_tiles ; ++first){
+        // walk until the tree is hit, remembering the last exit of every tile
+        for(size_t tile = first ; !in_tree[tile] ; ){
+            int_t x = tile % grid.x, y = tile / grid.x;
+            direction_t available = (y > 0)*NORTH | (x+1 < grid.x)*EAST | (y+1 < grid.y)*SOUTH | (x > 0)*WEST;
+            next[tile] = fast_random_direction(&random,available);
+            switch(next[tile]){
+                case NORTH: tile -= grid.x; break;
+                case EAST: tile += 1; break;
+                case SOUTH: tile += grid.x; break;
+                case WEST: tile -= 1; break;
+            }
+        }
+
+        // follow the loop erased walk, opening a passage across every step
+        for(size_t tile = first ; !in_tree[tile] ; ){
+            in_tree[tile] = true;
+            maze_t from = tiles[tile];
+            switch(next[tile]){
+                case NORTH: {
+                    maze_t to = tiles[tile - grid.x];
+                    int_t column = random_below(&random,from.dimensions.x);
+                    maze_at(from,column,0).open_directions |= NORTH;
+                    maze_at(to,column,to.dimensions.y-1).open_directions |= SOUTH;
+                    tile -= grid.x;
+                    break;
+                }
+                case SOUTH: {
+                    maze_t to = tiles[tile + grid.x];
+                    int_t column = random_below(&random,from.dimensions.x);
+                    maze_at(from,column,from.dimensions.y-1).open_directions |= SOUTH;
+                    maze_at(to,column,0).open_directions |= NORTH;
+                    tile += grid.x;
+                    break;
+                }
+                case EAST: {
+                    maze_t to = tiles[tile + 1];
+                    int_t row = random_below(&random,from.dimensions.y);
+                    maze_at(from,from.dimensions.x-1,row).open_directions |= EAST;
+                    maze_at(to,0,row).open_directions |= WEST;
+                    tile += 1;
+                    break;
+                }
+                case WEST: {
+                    maze_t to = tiles[tile - 1];
+                    int_t row = random_below(&random,from.dimensions.y);
+                    maze_at(from,0,row).open_directions |= WEST;
+                    maze_at(to,to.dimensions.x-1,row).open_directions |= EAST;
+                    tile -= 1;
+                    break;
+                }
+            }
+        }
+    }
+    free(next);
+    free(in_tree);
+}
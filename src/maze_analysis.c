@@ -0,0 +1,491 @@
+#include "maze_analysis.h"
+#include "common.h"
+#include "topology.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+// The maze is cut in bands of rows, one thread per band at a time. Every
+// cell checks its east and south walls against its neighbours, counts its
+// passages and, at the end of a corridor, walks it to the other end.
+//
+// Connectivity is found like in Eller's algorithm: a union find over the
+// columns of the current row tells which of its cells are connected
+// through the band so far, and going down a row the sets that don't reach
+// it are finished. So a band needs O(width) memory whatever its height.
+// Every set remembers a top row column it is connected to, if any, and the
+// top row columns have a union find of their own: what a band hands over is
+// which of its top row columns are connected, which of its bottom row
+// columns are, and how these meet. Bands are then glued in order with a
+// union find over those, the only part that isn't parallel.
+
+#define NO_COLUMN ((int_t)-1)
+#define ANALYSIS_BAND_ROWS 64
+
+typedef struct{
+    int_t y, rows;
+    int_t *top;                 // union find of the top row columns
+    int_t *bottom;              // set of every bottom row column
+    int_t *anchor;              // per bottom row set, a top row column of it
+    index_t finished;           // parts touching neither the top nor the bottom row
+    index_t passages, asymmetric, outside;
+    index_t degree[5];
+    index_t corridors, longest_corridor;
+    index_t corridor_length[MAZE_CORRIDOR_BUCKETS];
+} _analysis_band_t;
+
+typedef struct{
+    maze_t maze;
+    _analysis_band_t *bands;
+    uint32_t number_of_bands;
+    atomic_uint *next_band;
+    uint8_t id, workers;
+} _analysis_thread_args_t;
+
+// number of directions in a set of them: the build doesn't assume a
+// popcount instruction and the call to the library would cost more than
+// the rest of the pass, so it is a table of 16 nibbles
+static inline int count_walls(direction_t directions){
+    return (0x4332322132212110ULL >> ((directions & 15)*4)) & 15;
+}
+
+// walls of the cell open on both sides. The neighbours are read without
+// branches: behind a closed wall the cell reads itself, and what it reads
+// is dropped with the wall
+static inline direction_t cell_passages(maze_t maze, int_t x, int_t y){
+    const maze_vertex_t *cell = &maze_at(maze,x,y);
+    ptrdiff_t stride = maze.true_dimensions.x;
+    direction_t inside = (y > 0 ? NORTH : 0) | (x+1 < maze.dimensions.x ? EAST : 0) |
+                         (y+1 < maze.dimensions.y ? SOUTH : 0) | (x > 0 ? WEST : 0);
+    direction_t open = cell->open_directions & inside;
+    direction_t north = cell[open & NORTH ? -stride : 0].open_directions;
+    direction_t east = cell[open & EAST ? 1 : 0].open_directions;
+    direction_t south = cell[open & SOUTH ? stride : 0].open_directions;
+    direction_t west = cell[open & WEST ? -1 : 0].open_directions;
+    return open & ((((north & SOUTH) | (east & WEST)) >> 2) | (((south & NORTH) | (west & EAST)) << 2));
+}
+
+// passages of row y: between its first and last cells every neighbour is
+// there, past the top or bottom of the maze the row reads itself
+static void row_passages(maze_t maze, int_t y, direction_t *row){
+    int_t dim_x = maze.dimensions.x;
+    const maze_vertex_t *cell = &maze_at(maze,0,y);
+    const maze_vertex_t *up = y > 0 ? cell - maze.true_dimensions.x : cell;
+    const maze_vertex_t *down = y+1 < maze.dimensions.y ? cell + maze.true_dimensions.x : cell;
+    direction_t inside = (y > 0 ? NORTH : 0) | EAST | (y+1 < maze.dimensions.y ? SOUTH : 0) | WEST;
+    for(int_t x = 1 ; x+1 < dim_x ; ++x){
+        direction_t open = cell[x].open_directions & inside;
+        row[x] = open & ((((up[x].open_directions & SOUTH) | (cell[x+1].open_directions & WEST)) >> 2) |
+                         (((down[x].open_directions & NORTH) | (cell[x-1].open_directions & EAST)) << 2));
+    }
+    row[0] = cell_passages(maze,0,y);
+    row[dim_x-1] = cell_passages(maze,dim_x-1,y);
+}
+
+// passages of a cell of the current row to cells that aren't in a corridor,
+// from the passages of the rows around it
+static inline direction_t passages_away(const direction_t *above, const direction_t *cell,
+                                        const direction_t *below){
+    return ((count_walls(*above) != 2 ? NORTH : 0) | (count_walls(cell[1]) != 2 ? EAST : 0) |
+            (count_walls(*below) != 2 ? SOUTH : 0) | (count_walls(cell[-1]) != 2 ? WEST : 0)) & *cell;
+}
+
+static inline void step(int_t *x, int_t *y, direction_t direction){
+    int code = __builtin_ctz(direction);
+    *x += (code == 1) - (code == 3);
+    *y += (code == 2) - (code == 0);
+}
+
+static inline direction_t opposite(direction_t direction){
+    return ((direction << 2) | (direction >> 2)) & 15;
+}
+
+static inline void count_corridor(_analysis_band_t *band, index_t length){
+    band->corridors++;
+    band->corridor_length[63 - __builtin_clzll(length)]++;
+    if(length > band->longest_corridor) band->longest_corridor = length;
+}
+
+// walks the corridor, of more than one cell, from its end at (x,y) leaving
+// through direction. Corridors are found from both ends, the end first in
+// cell order counts it
+static void walk_corridor(maze_t maze, int_t x, int_t y, direction_t direction, _analysis_band_t *band){
+    int_t cx = x, cy = y;
+    index_t length = 1;
+    while(true){
+        int_t nx = cx, ny = cy;
+        step(&nx,&ny,direction);
+        direction_t next = cell_passages(maze,nx,ny);
+        if(count_walls(next) != 2) break;
+        direction = next & ~opposite(direction);
+        cx = nx;
+        cy = ny;
+        length++;
+    }
+    if(cy > y || (cy == y && cx > x)) count_corridor(band,length);
+}
+
+static inline int_t find_column(int_t *parent, int_t x){
+    while(parent[x] != x){
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static inline void join_columns(int_t *parent, int_t a, int_t b){
+    a = find_column(parent,a);
+    b = find_column(parent,b);
+    if(a < b) parent[b] = a;
+    else parent[a] = b;
+}
+
+// joins the sets of columns a and b of the row, and their top row columns
+static inline void join_sets(int_t *parent, int_t *anchor, int_t *top, int_t a, int_t b){
+    a = find_column(parent,a);
+    b = find_column(parent,b);
+    if(a == b) return;
+    if(anchor[a] != NO_COLUMN && anchor[b] != NO_COLUMN)
+        join_columns(top,anchor[a],anchor[b]);
+    int_t root = a < b ? a : b, other = a < b ? b : a;
+    parent[other] = root;
+    anchor[root] = anchor[root] != NO_COLUMN ? anchor[root] : anchor[other];
+}
+
+static void analyze_band(maze_t maze, _analysis_band_t *band, int_t *scratch, direction_t *rows){
+    int_t dim_x = maze.dimensions.x, dim_y = maze.dimensions.y;
+    int_t *parent = scratch, *anchor = scratch + dim_x;
+    int_t *next_parent = scratch + 2*(index_t)dim_x, *next_anchor = scratch + 3*(index_t)dim_x;
+    int_t *root = scratch + 4*(index_t)dim_x, *first = scratch + 5*(index_t)dim_x;
+    int_t *ends = scratch + 6*(index_t)dim_x;
+    // passages of the rows around the current one, with a column to spare
+    // on both sides
+    direction_t *above = rows + 1, *current = above + dim_x + 2, *below = current + dim_x + 2;
+    if(band->y > 0) row_passages(maze,band->y-1,above);
+    row_passages(maze,band->y,current);
+
+    for(int_t y = band->y ; y < band->y + band->rows ; ++y){
+        if(y+1 < dim_y) row_passages(maze,y+1,below);
+        // half the cells or so are in corridors and a third are at an end
+        // of one: branching on these would miss every other cell, so the
+        // ends are listed and walked after the row
+        direction_t inside_y = (y > 0 ? NORTH : 0) | (y+1 < dim_y ? SOUTH : 0);
+        index_t single = 0;
+        int_t number_of_ends = 0;
+        for(int_t x = 0 ; x < dim_x ; ++x){
+            direction_t inside = inside_y | (x+1 < dim_x ? EAST : 0) | (x > 0 ? WEST : 0);
+            direction_t open = maze_at(maze,x,y).open_directions, passages = current[x];
+            int degree = count_walls(passages);
+            // a wall open on one side only is counted from that side
+            band->outside += count_walls(open & ~inside);
+            band->asymmetric += count_walls(open & inside & ~passages);
+            band->passages += count_walls(passages & (EAST | SOUTH));
+            band->degree[degree]++;
+            // an end of a corridor has a passage to a cell that isn't in it,
+            // a corridor of one cell has two
+            direction_t away = passages_away(above + x,current + x,below + x);
+            single += degree == 2 && away == passages;
+            ends[number_of_ends] = x;
+            number_of_ends += degree == 2 && away && away != passages;
+        }
+        band->corridors += single;
+        band->corridor_length[0] += single;
+        if(single && band->longest_corridor < 1) band->longest_corridor = 1;
+        for(int_t i = 0 ; i < number_of_ends ; ++i){
+            int_t x = ends[i];
+            walk_corridor(maze,x,y,current[x] & ~passages_away(above + x,current + x,below + x),band);
+        }
+
+        if(y == band->y){
+            for(int_t x = 0 ; x < dim_x ; ++x){
+                parent[x] = x;
+                anchor[x] = x;
+                band->top[x] = x;
+            }
+        }else{
+            // the sets of the row above go down through their passages, the
+            // first column of a set to go down is the new root of the set
+            for(int_t x = 0 ; x < dim_x ; ++x){
+                root[x] = find_column(parent,x);
+                first[x] = NO_COLUMN;
+            }
+            for(int_t x = 0 ; x < dim_x ; ++x){
+                int_t r = root[x], set_first = first[r];
+                bool down = current[x] & NORTH;
+                bool new_root = down && set_first == NO_COLUMN;
+                first[r] = new_root ? x : set_first;
+                next_parent[x] = down && !new_root ? set_first : x;
+                next_anchor[x] = down ? anchor[r] : NO_COLUMN;
+            }
+            // the sets that didn't go down are finished, those reaching the
+            // top row are still part of the band's top row sets
+            for(int_t x = 0 ; x < dim_x ; ++x)
+                band->finished += root[x] == x && first[x] == NO_COLUMN && anchor[x] == NO_COLUMN;
+            int_t *swap = parent;
+            parent = next_parent;
+            next_parent = swap;
+            swap = anchor;
+            anchor = next_anchor;
+            next_anchor = swap;
+        }
+
+        for(int_t x = 0 ; x+1 < dim_x ; ++x)
+            if(current[x] & EAST)
+                join_sets(parent,anchor,band->top,x,x+1);
+
+        direction_t *oldest = above;
+        above = current;
+        current = below;
+        below = oldest;
+    }
+
+    for(int_t x = 0 ; x < dim_x ; ++x){
+        band->bottom[x] = find_column(parent,x);
+        band->anchor[x] = anchor[x];
+    }
+    for(int_t x = 0 ; x < dim_x ; ++x)
+        band->top[x] = find_column(band->top,x);
+}
+
+static void * _analysis_thread(void *void_args){
+    _analysis_thread_args_t *args = (_analysis_thread_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    int_t *scratch = (int_t*) malloc(7*(size_t)args->maze.dimensions.x*sizeof(int_t));
+    direction_t *rows = (direction_t*) calloc(3*((size_t)args->maze.dimensions.x+2),sizeof(direction_t));
+    if(!scratch || !rows) PERROR("Couldn't allocate rows to analyze a maze of width %u",args->maze.dimensions.x);
+    for(uint32_t band = atomic_fetch_add(args->next_band,1) ; band < args->number_of_bands ;
+        band = atomic_fetch_add(args->next_band,1))
+        analyze_band(args->maze,&args->bands[band],scratch,rows);
+    free(scratch);
+    free(rows);
+    return NULL;
+}
+
+static inline index_t find_id(index_t *parent, index_t id){
+    while(parent[id] != id){
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+static inline bool join_ids(index_t *parent, index_t a, index_t b){
+    a = find_id(parent,a);
+    b = find_id(parent,b);
+    if(a == b) return false;
+    if(a < b) parent[b] = a;
+    else parent[a] = b;
+    return true;
+}
+
+// parts of the maze once the bands are glued: band b has ids for its top
+// row columns from 2*b*width and for its bottom row sets from (2*b+1)*width
+static index_t count_components(maze_t maze, _analysis_band_t *bands, uint32_t number_of_bands){
+    index_t dim_x = maze.dimensions.x;
+    index_t *parent = (index_t*) malloc(2*dim_x*number_of_bands*sizeof(index_t));
+    if(!parent) PERROR("Couldn't allocate space to glue the bands of a maze analysis");
+    for(index_t id = 0 ; id < 2*dim_x*number_of_bands ; ++id)
+        parent[id] = id;
+
+    index_t components = 0;
+    for(uint32_t b = 0 ; b < number_of_bands ; ++b){
+        _analysis_band_t *band = &bands[b];
+        index_t top = 2*b*dim_x, bottom = top + dim_x;
+        components += band->finished + dim_x;
+        for(index_t x = 0 ; x < dim_x ; ++x){
+            components -= join_ids(parent,top + x,top + band->top[x]);
+            if(band->bottom[x] != x) continue;
+            components++;
+            if(band->anchor[x] != NO_COLUMN)
+                components -= join_ids(parent,bottom + x,top + band->anchor[x]);
+        }
+        if(b == 0) continue;
+        int_t y = band->y;
+        _analysis_band_t *above = &bands[b-1];
+        for(index_t x = 0 ; x < dim_x ; ++x)
+            if((maze_at(maze,x,y-1).open_directions & SOUTH) && (maze_at(maze,x,y).open_directions & NORTH))
+                components -= join_ids(parent,bottom - 2*dim_x + above->bottom[x],top + x);
+    }
+    free(parent);
+    return components;
+}
+
+typedef struct{
+    uint64_t *seen;             // a bit per cell
+    vec2_t *frontier, *next;    // cells at depth steps, cells one step further
+    index_t count, capacity, next_capacity, depth;
+} _search_side_t;
+
+static void begin_side(_search_side_t *side, maze_t maze, vec2_t cell){
+    index_t cells = (index_t)maze.dimensions.x*maze.dimensions.y, i = cell.x + (index_t)cell.y*maze.dimensions.x;
+    side->seen = (uint64_t*) alloc_cells((cells+63)/64,sizeof(uint64_t));
+    side->capacity = side->next_capacity = 1024;
+    side->frontier = (vec2_t*) malloc(side->capacity*sizeof(vec2_t));
+    side->next = (vec2_t*) malloc(side->next_capacity*sizeof(vec2_t));
+    if(!side->frontier || !side->next) PERROR("Couldn't allocate the frontier to solve a maze");
+    side->frontier[0] = cell;
+    side->count = 1;
+    side->depth = 0;
+    side->seen[i/64] |= (uint64_t)1 << (i%64);
+}
+
+static void end_side(_search_side_t *side){
+    free(side->seen);
+    free(side->frontier);
+    free(side->next);
+}
+
+static inline bool was_seen(const _search_side_t *side, index_t cell){
+    return (side->seen[cell/64] >> (cell%64)) & 1;
+}
+
+// takes side one step further. Returns whether it met the other side,
+// whose frontier is then one step away
+static bool search_step(maze_t maze, _search_side_t *side, const _search_side_t *other){
+    index_t dim_x = maze.dimensions.x, count = 0;
+    for(index_t i = 0 ; i < side->count ; ++i){
+        int_t x = side->frontier[i].x, y = side->frontier[i].y;
+        direction_t passages = cell_passages(maze,x,y);
+        while(passages){
+            direction_t d = passages & -passages;
+            passages ^= d;
+            int_t nx = x, ny = y;
+            step(&nx,&ny,d);
+            index_t neighbour = nx + ny*dim_x;
+            if(was_seen(other,neighbour)) return true;
+            if(was_seen(side,neighbour)) continue;
+            side->seen[neighbour/64] |= (uint64_t)1 << (neighbour%64);
+            if(count == side->next_capacity){
+                side->next_capacity *= 2;
+                side->next = (vec2_t*) realloc(side->next,side->next_capacity*sizeof(vec2_t));
+                if(!side->next) PERROR("Couldn't grow the frontier to solve a maze");
+            }
+            side->next[count++] = (vec2_t){nx,ny};
+        }
+    }
+    vec2_t *swap = side->frontier;
+    index_t capacity = side->capacity;
+    side->frontier = side->next;
+    side->capacity = side->next_capacity;
+    side->next = swap;
+    side->next_capacity = capacity;
+    side->count = count;
+    side->depth++;
+    return false;
+}
+
+// breadth first search from both ends, the smaller frontier going one step
+// further at a time. The first cell of one side found next to the other
+// side is on a shortest path: anything shorter would have met earlier
+static index_t solution_length(maze_t maze, vec2_t start, vec2_t goal){
+    if(start.x == goal.x && start.y == goal.y) return 0;
+    _search_side_t sides[2];
+    begin_side(&sides[0],maze,start);
+    begin_side(&sides[1],maze,goal);
+    index_t length = MAZE_NO_PATH;
+    while(sides[0].count && sides[1].count){
+        int s = sides[0].count <= sides[1].count ? 0 : 1;
+        if(search_step(maze,&sides[s],&sides[1-s])){
+            length = sides[0].depth + sides[1].depth + 1;
+            break;
+        }
+    }
+    end_side(&sides[0]);
+    end_side(&sides[1]);
+    return length;
+}
+
+
+
+maze_analysis_t analyze_maze(maze_t maze, vec2_t start, vec2_t goal, uint8_t workers){
+    int_t dim_x = maze.dimensions.x, dim_y = maze.dimensions.y;
+    if(dim_x == 0 || dim_y == 0) PERROR("Can't analyze an empty maze");
+    if(start.x >= dim_x || start.y >= dim_y || goal.x >= dim_x || goal.y >= dim_y)
+        PERROR("Start (%u,%u) or goal (%u,%u) out of a %ux%u maze",start.x,start.y,goal.x,goal.y,dim_x,dim_y);
+    if(workers < 1) workers = 1;
+
+    // a few bands per worker to even out the load, not so thin that gluing
+    // them costs more than a band
+    int_t rows = (dim_y + 4*workers - 1)/(4*workers);
+    if(rows < ANALYSIS_BAND_ROWS) rows = ANALYSIS_BAND_ROWS;
+    uint32_t number_of_bands = (dim_y + rows - 1)/rows;
+    _analysis_band_t *bands = calloc(number_of_bands,sizeof(_analysis_band_t));
+    int_t *columns = (int_t*) malloc(3*(size_t)dim_x*number_of_bands*sizeof(int_t));
+    if(!bands || !columns) PERROR("Couldn't allocate the bands to analyze a %ux%u maze",dim_x,dim_y);
+    for(uint32_t b = 0 ; b < number_of_bands ; ++b){
+        bands[b].y = b*rows;
+        bands[b].rows = dim_y - b*rows < rows ? dim_y - b*rows : rows;
+        bands[b].top = columns + 3*(size_t)dim_x*b;
+        bands[b].bottom = bands[b].top + dim_x;
+        bands[b].anchor = bands[b].bottom + dim_x;
+    }
+
+    atomic_uint next_band;
+    atomic_init(&next_band,0);
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _analysis_thread_args_t *args = calloc(workers,sizeof(_analysis_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while analyzing maze.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_analysis_thread_args_t){maze,bands,number_of_bands,&next_band,i,workers};
+        pthread_create(&tid[i],NULL,_analysis_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+    free(tid);
+    free(args);
+
+    maze_analysis_t analysis = {0};
+    analysis.cells = (index_t)dim_x*dim_y;
+    for(uint32_t b = 0 ; b < number_of_bands ; ++b){
+        analysis.passages += bands[b].passages;
+        analysis.asymmetric += bands[b].asymmetric;
+        analysis.outside += bands[b].outside;
+        for(int d = 0 ; d < 5 ; ++d)
+            analysis.degree[d] += bands[b].degree[d];
+        analysis.corridors += bands[b].corridors;
+        for(int i = 0 ; i < MAZE_CORRIDOR_BUCKETS ; ++i)
+            analysis.corridor_length[i] += bands[b].corridor_length[i];
+        if(bands[b].longest_corridor > analysis.longest_corridor)
+            analysis.longest_corridor = bands[b].longest_corridor;
+    }
+    analysis.components = count_components(maze,bands,number_of_bands);
+    free(columns);
+    free(bands);
+
+    if(analysis.asymmetric || analysis.outside) analysis.kind = MAZE_INVALID;
+    else if(analysis.components > 1) analysis.kind = MAZE_DISCONNECTED;
+    else if(analysis.passages == analysis.cells - 1) analysis.kind = MAZE_PERFECT;
+    else analysis.kind = MAZE_BRAIDED;
+
+    analysis.solution_length = solution_length(maze,start,goal);
+    return analysis;
+}
+
+const char *maze_kind_name(enum maze_kind kind){
+    switch(kind){
+        case MAZE_INVALID: return "invalid";
+        case MAZE_DISCONNECTED: return "disconnected";
+        case MAZE_PERFECT: return "perfect";
+        default: return "braided";
+    }
+}
+
+void print_maze_analysis(const maze_analysis_t *analysis){
+    printf("%s maze: %"PRIu64" cells, %"PRIu64" passages, %"PRIu64" parts\n",maze_kind_name(analysis->kind),
+           analysis->cells,analysis->passages,analysis->components);
+    if(analysis->asymmetric || analysis->outside)
+        printf("%"PRIu64" walls open on one side only, %"PRIu64" open to the outside\n",
+               analysis->asymmetric,analysis->outside);
+    printf("cells by passages: %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" (0 to 4), %"PRIu64" dead ends, %"PRIu64" junctions\n",
+           analysis->degree[0],analysis->degree[1],analysis->degree[2],analysis->degree[3],analysis->degree[4],
+           analysis->degree[1],analysis->degree[3] + analysis->degree[4]);
+    printf("%"PRIu64" corridors, the longest %"PRIu64" cells\n",analysis->corridors,analysis->longest_corridor);
+    for(int i = 0 ; i < MAZE_CORRIDOR_BUCKETS ; ++i)
+        if(analysis->corridor_length[i])
+            printf("  %"PRIu64" to %"PRIu64" cells: %"PRIu64"\n",(index_t)1 << i,((index_t)2 << i) - 1,
+                   analysis->corridor_length[i]);
+    if(analysis->solution_length == MAZE_NO_PATH) printf("no path from start to goal\n");
+    else printf("solution: %"PRIu64" steps\n",analysis->solution_length);
+}
@@ -0,0 +1,154 @@
+#include "maze.h"
+#include "common.h"
+#include "random.h"
+#include "topology.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Braiding: every dead end is picked with probability fraction and gets a
+// wall opened, which puts it on a loop. Picked neighbours are preferred, so
+// one passage takes away two of them.
+//
+// Opening a wall touches the cell and a neighbour, and the choice reads the
+// neighbours, so a cell only reaches one cell out of its tile. The tiles
+// are coloured like a 2x2 checkerboard: tiles of the same colour are a
+// whole tile apart and are braided at the same time, the four colours one
+// after the other. The picks are keyed by cell and every tile is braided in
+// the same order, so the maze depends on the seed only, not on the workers.
+
+#define BRAID_TILE_SIDE 64
+
+typedef struct{
+    maze_t maze;
+    vec2_t grid;
+    uint64_t seed, threshold;
+    atomic_uint *next_tile;     // one counter per colour
+    atomic_uint_fast64_t *opened;
+    pthread_barrier_t *barrier;
+    uint8_t id, workers;
+} _braid_thread_args_t;
+
+// closed directions of the cell that lead to a cell of the maze
+static inline direction_t closed_directions(maze_t maze, int_t x, int_t y){
+    direction_t inside = (y > 0 ? NORTH : 0) | (x+1 < maze.dimensions.x ? EAST : 0) |
+                         (y+1 < maze.dimensions.y ? SOUTH : 0) | (x > 0 ? WEST : 0);
+    return inside & ~maze_at(maze,x,y).open_directions;
+}
+
+static inline bool is_dead_end(maze_t maze, int_t x, int_t y){
+    return __builtin_popcount(maze_at(maze,x,y).open_directions) == 1;
+}
+
+// whether the cell is one of the dead ends to braid, still there
+static inline bool is_picked(maze_t maze, int_t x, int_t y, uint64_t seed, uint64_t threshold){
+    index_t key = x + (index_t)y*maze.dimensions.x;
+    return is_dead_end(maze,x,y) && (keyed_random(seed,key) >> 11) < threshold;
+}
+
+static index_t braid_tile(maze_t maze, int_t tile_x, int_t tile_y, uint64_t seed, uint64_t threshold){
+    int_t end_x = tile_x + BRAID_TILE_SIDE < maze.dimensions.x ? tile_x + BRAID_TILE_SIDE : maze.dimensions.x;
+    int_t end_y = tile_y + BRAID_TILE_SIDE < maze.dimensions.y ? tile_y + BRAID_TILE_SIDE : maze.dimensions.y;
+    index_t opened = 0;
+    for(int_t y = tile_y ; y < end_y ; ++y){
+        for(int_t x = tile_x ; x < end_x ; ++x){
+            if(!is_picked(maze,x,y,seed,threshold)) continue;
+            direction_t closed = closed_directions(maze,x,y);
+            if(!closed) continue;
+
+            // joining two picked dead ends takes both away with one passage.
+            // Otherwise a dead end that wasn't picked is left alone, so
+            // about fraction of the dead ends go, not more
+            direction_t picked = 0, dead = 0;
+            if(closed & NORTH){
+                picked |= is_picked(maze,x,y-1,seed,threshold) ? NORTH : 0;
+                dead |= is_dead_end(maze,x,y-1) ? NORTH : 0;
+            }
+            if(closed & EAST){
+                picked |= is_picked(maze,x+1,y,seed,threshold) ? EAST : 0;
+                dead |= is_dead_end(maze,x+1,y) ? EAST : 0;
+            }
+            if(closed & SOUTH){
+                picked |= is_picked(maze,x,y+1,seed,threshold) ? SOUTH : 0;
+                dead |= is_dead_end(maze,x,y+1) ? SOUTH : 0;
+            }
+            if(closed & WEST){
+                picked |= is_picked(maze,x-1,y,seed,threshold) ? WEST : 0;
+                dead |= is_dead_end(maze,x-1,y) ? WEST : 0;
+            }
+            direction_t available = picked ? picked : (closed & ~dead) ? closed & ~dead : closed;
+            // the stream of the direction is apart from the one of the pick
+            index_t key = x + (index_t)y*maze.dimensions.x;
+            direction_t direction = keyed_random_direction(~seed,key,available);
+
+            maze_at(maze,x,y).open_directions |= direction;
+            switch(direction){
+                case NORTH: maze_at(maze,x,y-1).open_directions |= SOUTH; break;
+                case EAST: maze_at(maze,x+1,y).open_directions |= WEST; break;
+                case SOUTH: maze_at(maze,x,y+1).open_directions |= NORTH; break;
+                case WEST: maze_at(maze,x-1,y).open_directions |= EAST; break;
+            }
+            opened++;
+        }
+    }
+    return opened;
+}
+
+static void * _braid_thread(void *void_args){
+    _braid_thread_args_t *args = (_braid_thread_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    vec2_t grid = args->grid;
+    // tiles of a colour, with its corner tile at (colour & 1, colour >> 1)
+    uint32_t colour_x[4], colour_y[4];
+    for(uint8_t colour = 0 ; colour < 4 ; ++colour){
+        colour_x[colour] = (grid.x + 1 - (colour & 1))/2;
+        colour_y[colour] = (grid.y + 1 - (colour >> 1))/2;
+    }
+    index_t opened = 0;
+    for(uint8_t colour = 0 ; colour < 4 ; ++colour){
+        uint32_t tiles = colour_x[colour]*colour_y[colour];
+        for(uint32_t tile = atomic_fetch_add(&args->next_tile[colour],1) ; tile < tiles ;
+            tile = atomic_fetch_add(&args->next_tile[colour],1)){
+            int_t tile_x = 2*(tile % colour_x[colour]) + (colour & 1);
+            int_t tile_y = 2*(tile / colour_x[colour]) + (colour >> 1);
+            opened += braid_tile(args->maze,tile_x*BRAID_TILE_SIDE,tile_y*BRAID_TILE_SIDE,
+                                 args->seed,args->threshold);
+        }
+        pthread_barrier_wait(args->barrier);
+    }
+    atomic_fetch_add(args->opened,opened);
+    return NULL;
+}
+
+
+
+index_t braid_maze(maze_t maze, double fraction, uint8_t workers, uint64_t seed){
+    if(workers < 1) workers = 1;
+    if(fraction <= 0 || maze.dimensions.x == 0 || maze.dimensions.y == 0) return 0;
+    // dead ends are picked when the top 53 bits of their key are below this
+    uint64_t threshold = fraction >= 1 ? (uint64_t)1 << 53 : (uint64_t)(fraction*(double)((uint64_t)1 << 53));
+
+    vec2_t grid = {(maze.dimensions.x + BRAID_TILE_SIDE-1)/BRAID_TILE_SIDE,
+                   (maze.dimensions.y + BRAID_TILE_SIDE-1)/BRAID_TILE_SIDE};
+    atomic_uint next_tile[4];
+    for(uint8_t colour = 0 ; colour < 4 ; ++colour)
+        atomic_init(&next_tile[colour],0);
+    atomic_uint_fast64_t opened;
+    atomic_init(&opened,0);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier,NULL,workers);
+
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _braid_thread_args_t *args = calloc(workers,sizeof(_braid_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while braiding maze.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_braid_thread_args_t){maze,grid,seed,threshold,next_tile,&opened,&barrier,i,workers};
+        pthread_create(&tid[i],NULL,_braid_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    pthread_barrier_destroy(&barrier);
+    free(tid);
+    free(args);
+    return atomic_load(&opened);
+}
@@ -0,0 +1,130 @@
+#include "maze.h"
+#include "common.h"
+#include "random.h"
+#include "task_pool.h"
+
+// Recursive division: a region is cut in two across its longer side at a
+// random place, the halves are joined by a single passage at a random place
+// of the cut and each half is divided the same way, down to corridors one
+// cell wide. The cuts are the long straight walls the method is known for.
+//
+// The halves are sub-maze views of the region, so they never share a cell.
+// The joining passage is opened before the halves are divided and then
+// only ORed into, so the halves can be divided at the same time: regions
+// bigger than DIVISION_SERIAL_CELLS are split into tasks for a work
+// stealing pool, smaller ones are divided by the worker that gets them.
+//
+// Every region has a random key, its cuts are chosen from the bits of the
+// key and the keys of its halves are mixed from it: the maze depends on the
+// seed only, not on who divides what.
+
+#define DIVISION_SERIAL_CELLS (1<<16)
+
+typedef struct{
+    maze_t maze;
+    uint64_t key;
+} _division_task_t;
+
+// where a region is cut: across x (a wall from top to bottom) or across y,
+// before column or row cut, with the passage at passage along the cut
+typedef struct{
+    bool across_x;
+    int_t cut, passage;
+} _division_cut_t;
+
+static inline _division_cut_t choose_cut(int_t dim_x, int_t dim_y, uint64_t key){
+    // the lowest bit breaks ties between the sides, 31 bits place the cut
+    // and 32 the passage
+    bool across_x = dim_x > dim_y || (dim_x == dim_y && (key & 1));
+    uint64_t cut_bits = (key >> 1) & 0x7FFFFFFF;
+    uint64_t passage_bits = key >> 32;
+    int_t length = across_x ? dim_x : dim_y, width = across_x ? dim_y : dim_x;
+    return (_division_cut_t){across_x,1 + ((cut_bits*(length-1)) >> 31),(passage_bits*width) >> 32};
+}
+
+static inline uint64_t child_key(uint64_t key, int child){
+    return mix64(key + (child+1)*0x9e3779b97f4a7c15ULL);
+}
+
+// The small regions are most of the work, there are about as many of them
+// as cells: they are plain pointers into the maze with its row stride
+// instead of sub-maze views. The recursion goes into the smaller half and
+// loops on the bigger one, so the stack stays logarithmic however the cuts
+// fall.
+static void divide_serial(maze_vertex_t *cells, index_t stride, int_t dim_x, int_t dim_y, uint64_t key){
+    while(dim_x > 1 && dim_y > 1){
+        _division_cut_t cut = choose_cut(dim_x,dim_y,key);
+        maze_vertex_t *second;
+        int_t first_x = dim_x, first_y = dim_y, second_x = dim_x, second_y = dim_y;
+        if(cut.across_x){
+            cells[cut.cut-1 + cut.passage*stride].open_directions |= EAST;
+            cells[cut.cut + cut.passage*stride].open_directions |= WEST;
+            second = cells + cut.cut;
+            first_x = cut.cut;
+            second_x = dim_x - cut.cut;
+        }else{
+            cells[cut.passage + (cut.cut-1)*stride].open_directions |= SOUTH;
+            cells[cut.passage + cut.cut*stride].open_directions |= NORTH;
+            second = cells + cut.cut*stride;
+            first_y = cut.cut;
+            second_y = dim_y - cut.cut;
+        }
+        if((index_t)first_x*first_y < (index_t)second_x*second_y){
+            divide_serial(cells,stride,first_x,first_y,child_key(key,0));
+            cells = second;
+            dim_x = second_x;
+            dim_y = second_y;
+            key = child_key(key,1);
+        }else{
+            divide_serial(second,stride,second_x,second_y,child_key(key,1));
+            dim_x = first_x;
+            dim_y = first_y;
+            key = child_key(key,0);
+        }
+    }
+
+    // a region one cell wide or high is a straight corridor
+    if(dim_x == 1){
+        for(int_t y = 0 ; y < dim_y ; ++y)
+            cells[y*stride].open_directions |= (y > 0 ? NORTH : 0) | (y+1 < dim_y ? SOUTH : 0);
+    }else{
+        for(int_t x = 0 ; x < dim_x ; ++x)
+            cells[x].open_directions |= (x > 0 ? WEST : 0) | (x+1 < dim_x ? EAST : 0);
+    }
+}
+
+// big regions spawn one half as a task and keep dividing the other one
+static void _division_task(task_pool_t *pool, void *payload, uint8_t worker){
+    _division_task_t task = *(_division_task_t*) payload;
+    while((index_t)task.maze.dimensions.x*task.maze.dimensions.y > DIVISION_SERIAL_CELLS &&
+          task.maze.dimensions.x > 1 && task.maze.dimensions.y > 1){
+        maze_t maze = task.maze;
+        _division_cut_t cut = choose_cut(maze.dimensions.x,maze.dimensions.y,task.key);
+        _division_task_t spawned = {maze,child_key(task.key,1)};
+        if(cut.across_x){
+            maze_at(maze,cut.cut-1,cut.passage).open_directions |= EAST;
+            maze_at(maze,cut.cut,cut.passage).open_directions |= WEST;
+            task.maze = get_sub_maze(maze,0,0,cut.cut,maze.dimensions.y);
+            spawned.maze = get_sub_maze(maze,cut.cut,0,maze.dimensions.x,maze.dimensions.y);
+        }else{
+            maze_at(maze,cut.passage,cut.cut-1).open_directions |= SOUTH;
+            maze_at(maze,cut.passage,cut.cut).open_directions |= NORTH;
+            task.maze = get_sub_maze(maze,0,0,maze.dimensions.x,cut.cut);
+            spawned.maze = get_sub_maze(maze,0,cut.cut,maze.dimensions.x,maze.dimensions.y);
+        }
+        task_pool_spawn(pool,worker,_division_task,&spawned,sizeof(spawned));
+        task.key = child_key(task.key,0);
+    }
+    divide_serial(&maze_at(task.maze,0,0),task.maze.true_dimensions.x,
+                  task.maze.dimensions.x,task.maze.dimensions.y,task.key);
+}
+
+
+
+maze_t generate_random_maze_division(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed){
+    maze_t maze;
+    alloc_maze_for_workers(&maze,dim_x,dim_y,workers);
+    _division_task_t root = {maze,keyed_random(seed,0)};
+    task_pool_run(workers,_division_task,&root,sizeof(root));
+    return maze;
+}
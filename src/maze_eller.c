@@ -0,0 +1,168 @@
+#include "maze.h"
+#include "common.h"
+#include "random.h"
+#include "maze_file.h"
+#include <inttypes.h>
+#include <string.h>
+
+// Eller's algorithm: the maze is built one row at a time, only knowing
+// which cells of the current row are already connected (through the rows
+// above). Neighbours of different sets are joined at random, then every
+// set goes down to the next row through at least one cell; the cells that
+// don't get a passage from above start sets of their own. The last row
+// joins whatever is still apart.
+//
+// The sets are a union find over the columns of the row, so all of it is
+// O(width) memory whatever the height: rows can go straight to a file.
+
+#define NO_CELL ((int_t)-1)
+// columns between the arrays of a row, a cache line of them
+#define ELLER_PADDING (64/sizeof(int_t))
+
+typedef struct{
+    int_t dim_x;
+    uint64_t dim_y, y;
+    random_t random;
+    maze_vertex_t *row;         // the row being built, north passages already in
+    int_t *parent;              // union find of the columns
+    int_t *root;                // root of every column once the row is joined
+    int_t *last;                // per root, its last column
+    int_t *below;               // per root, a column going down, one extra
+                                // slot takes the columns that don't
+} eller_t;
+
+static void begin_eller(eller_t *eller, int_t dim_x, uint64_t dim_y, uint64_t seed){
+    eller->dim_x = dim_x;
+    eller->dim_y = dim_y;
+    eller->y = 0;
+    seed_random(&eller->random,seed);
+    eller->row = (maze_vertex_t*) calloc(dim_x,sizeof(maze_vertex_t));
+    // the arrays are read and written at the same column together: padding
+    // them a cache line apart keeps them from being a multiple of 4KiB
+    // apart, where loads would wait on unrelated stores
+    size_t stride = (size_t)dim_x + ELLER_PADDING;
+    eller->parent = (int_t*) malloc(4*stride*sizeof(int_t));
+    if(!eller->row || !eller->parent) PERROR("Couldn't allocate rows for Eller's algorithm with width %u",dim_x);
+    eller->root = eller->parent + stride;
+    eller->last = eller->root + stride;
+    eller->below = eller->last + stride;
+    for(int_t x = 0 ; x < dim_x ; ++x)
+        eller->parent[x] = x;
+}
+
+static void end_eller(eller_t *eller){
+    free(eller->row);
+    free(eller->parent);
+}
+
+// 64 coin flips at a time
+static inline uint64_t coins(eller_t *eller){
+    return next_random(&eller->random);
+}
+
+// sets are flat at the start of a row and only the roots are hung under
+// others while joining, so two steps almost always reach the root: taking
+// them unconditionally beats a loop that stops after a random number of them
+static inline int_t find_set(int_t *parent, int_t x){
+    int_t r = parent[parent[x]];
+    while(parent[r] != r)
+        r = parent[r];
+    return r;
+}
+
+// builds the next row in eller->row. Every decision is a coin flip, so
+// they are taken without branches, and the bookkeeping per set is only
+// ever stored, never read back and updated: a mispredicted branch or a
+// dependency through memory per cell would cost more than the rest
+static void eller_next_row(eller_t *eller){
+    int_t dim_x = eller->dim_x;
+    maze_vertex_t *row = eller->row;
+    int_t *parent = eller->parent, *root = eller->root;
+    int_t *last = eller->last, *below = eller->below;
+    bool last_row = eller->y+1 == eller->dim_y;
+    eller->y++;
+
+    // joining always hangs the right set under the left one, so the set of
+    // the column on the left is known without looking it up again
+    uint64_t flips = 0;
+    int_t left = find_set(parent,0);
+    root[0] = left;
+    for(int_t x = 0 ; x+1 < dim_x ; ++x){
+        if((x & 63) == 0) flips = last_row ? ~(uint64_t)0 : coins(eller);
+        int_t right = find_set(parent,x+1);
+        bool join = (left != right) & (flips >> (x & 63));
+        parent[right] = join ? left : right;
+        row[x].open_directions |= join ? EAST : 0;
+        row[x+1].open_directions |= join ? WEST : 0;
+        left = join ? left : right;
+        root[x+1] = right;
+    }
+    if(last_row) return;
+
+    // a column's set may have been joined after the column was passed
+    for(int_t x = 0 ; x < dim_x ; ++x){
+        int_t r = find_set(parent,root[x]);
+        root[x] = r;
+        below[r] = NO_CELL;
+        last[x] = x;
+    }
+
+    for(int_t x = 0 ; x < dim_x ; ++x){
+        if((x & 63) == 0) flips = coins(eller);
+        int_t r = root[x];
+        bool down = (flips >> (x & 63)) & 1;
+        row[x].open_directions |= down ? SOUTH : 0;
+        below[down ? r : dim_x] = x;
+        last[r] = x;
+    }
+
+    // sets the coins left without a way down take it at their last column
+    for(int_t x = 0 ; x < dim_x ; ++x){
+        bool stuck = (root[x] == x) & (below[x] == NO_CELL);
+        below[x] = stuck ? last[x] : below[x];
+        row[last[x]].open_directions |= stuck ? SOUTH : 0;
+    }
+}
+
+// moves on to the next row: the columns going down keep their set, the
+// others start a new one
+static void eller_advance(eller_t *eller){
+    maze_vertex_t *row = eller->row;
+    int_t *parent = eller->parent, *root = eller->root, *below = eller->below;
+    for(int_t x = 0 ; x < eller->dim_x ; ++x){
+        bool down = row[x].open_directions & SOUTH;
+        parent[x] = down ? below[root[x]] : x;
+        row[x].open_directions = down ? NORTH : 0;
+    }
+}
+
+
+
+maze_t generate_random_maze_eller(int_t dim_x, int_t dim_y, uint64_t seed){
+    maze_t maze;
+    alloc_maze(&maze,dim_x,dim_y);
+    eller_t eller;
+    begin_eller(&eller,dim_x,dim_y,seed);
+    for(int_t y = 0 ; y < dim_y ; ++y){
+        eller_next_row(&eller);
+        memcpy(&maze_at(maze,0,y),eller.row,dim_x*sizeof(maze_vertex_t));
+        eller_advance(&eller);
+    }
+    end_eller(&eller);
+    return maze;
+}
+
+void write_maze_file_eller(int fd, int_t dim_x, uint64_t dim_y, uint64_t seed){
+    if(dim_x == 0 || dim_y == 0) PERROR("Can't generate a %u x %"PRIu64" maze",dim_x,dim_y);
+    maze_file_writer_t writer;
+    begin_maze_file(&writer,fd,dim_x,dim_y,(maze_file_info_t){MAZE_GENERATOR_ELLER,seed});
+    eller_t eller;
+    begin_eller(&eller,dim_x,dim_y,seed);
+    for(uint64_t y = 0 ; y < dim_y ; ++y){
+        eller_next_row(&eller);
+        write_maze_file_row(&writer,eller.row);
+        eller_advance(&eller);
+    }
+    end_eller(&eller);
+    end_maze_file(&writer);
+}
@@ -0,0 +1,298 @@
+#include "maze_file.h"
+#include "common.h"
+#include "topology.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+_Static_assert(sizeof(maze_file_header_t) == 64, "maze file header must be 64 bytes");
+
+
+
+// FNV-1a over 64 bit words (and the trailing bytes), rows are
+// hashed independently so they can be hashed in parallel
+static uint64_t maze_file_row_hash(const uint8_t *row, size_t row_bytes){
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t i = 0;
+    for(; i + 8 <= row_bytes ; i += 8){
+        uint64_t word;
+        memcpy(&word,row+i,8);
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for(; i < row_bytes ; ++i)
+        hash = (hash ^ row[i]) * FNV_PRIME;
+    return hash;
+}
+
+// the file hash folds the row hashes in order
+static uint64_t fold_row_hash(uint64_t hash, uint64_t row_hash){
+    return (hash ^ row_hash) * FNV_PRIME;
+}
+
+
+
+static void write_bytes(int fd, const void *bytes, size_t count){
+    const uint8_t *data = (const uint8_t*) bytes;
+    while(count > 0){
+        ssize_t written = write(fd,data,count);
+        if(written <= 0) PERROR("Couldn't write maze file to file descriptor %d",fd);
+        data += written;
+        count -= written;
+    }
+}
+
+
+
+// packed cells of a row, (dim_x+1)/2 without overflowing
+static inline uint64_t maze_file_row_bytes(uint64_t dim_x){
+    return dim_x/2 + (dim_x&1);
+}
+
+
+
+void begin_maze_file(maze_file_writer_t *writer, int fd, uint64_t dim_x, uint64_t dim_y, maze_file_info_t info){
+    if(dim_x == 0 || dim_y == 0)
+        PERROR("Can't write a maze file of %lu x %lu cells",(unsigned long)dim_x,(unsigned long)dim_y);
+    memset(&writer->header,0,sizeof(maze_file_header_t));
+    memcpy(writer->header.magic,MAZE_FILE_MAGIC,4);
+    writer->header.version = MAZE_FILE_VERSION;
+    writer->header.dim_x = dim_x;
+    writer->header.dim_y = dim_y;
+    writer->header.generator = info.generator;
+    writer->header.seed = info.seed;
+    writer->header.row_bytes = maze_file_row_bytes(dim_x);
+
+    writer->fd = fd;
+    writer->rows_written = 0;
+    writer->hash = FNV_OFFSET_BASIS;
+    // rows are written a chunk at a time, narrow mazes would otherwise
+    // cost a system call every few bytes
+    writer->buffer_rows = MAZE_FILE_WRITE_CHUNK/writer->header.row_bytes + 1;
+    writer->buffered_rows = 0;
+    writer->buffer = (uint8_t*) malloc(writer->buffer_rows*writer->header.row_bytes);
+    if(!writer->buffer) PERROR("Couldn't allocate rows for maze file with width %lu",(unsigned long)dim_x);
+
+    // the hash is only known at the end, it is filled in by end_maze_file
+    write_bytes(fd,&writer->header,sizeof(maze_file_header_t));
+}
+
+
+
+static void flush_maze_file(maze_file_writer_t *writer){
+    write_bytes(writer->fd,writer->buffer,writer->buffered_rows*writer->header.row_bytes);
+    writer->buffered_rows = 0;
+}
+
+// where the next row is packed
+static inline uint8_t *next_row(maze_file_writer_t *writer){
+    if(writer->rows_written >= writer->header.dim_y)
+        PERROR("Too many rows written to maze file with height %lu",(unsigned long)writer->header.dim_y);
+    return writer->buffer + writer->buffered_rows*writer->header.row_bytes;
+}
+
+static inline void commit_row(maze_file_writer_t *writer, const uint8_t *packed_row){
+    writer->hash = fold_row_hash(writer->hash,maze_file_row_hash(packed_row,writer->header.row_bytes));
+    writer->rows_written++;
+    if(++writer->buffered_rows == writer->buffer_rows) flush_maze_file(writer);
+}
+
+
+
+void write_maze_file_packed_row(maze_file_writer_t *writer, const uint8_t *packed_row){
+    uint8_t *row = next_row(writer);
+    memcpy(row,packed_row,writer->header.row_bytes);
+    commit_row(writer,row);
+}
+
+
+
+static void pack_row(uint8_t *packed, const maze_vertex_t *row, uint64_t dim_x){
+    uint64_t x = 0;
+    for(; x + 1 < dim_x ; x += 2)
+        packed[x>>1] = (row[x].open_directions & 0xF) | ((row[x+1].open_directions & 0xF) << 4);
+    if(x < dim_x)
+        packed[x>>1] = row[x].open_directions & 0xF;
+}
+
+
+
+void write_maze_file_row(maze_file_writer_t *writer, const maze_vertex_t *row){
+    uint8_t *packed = next_row(writer);
+    pack_row(packed,row,writer->header.dim_x);
+    commit_row(writer,packed);
+}
+
+
+
+void end_maze_file(maze_file_writer_t *writer){
+    if(writer->rows_written != writer->header.dim_y)
+        PERROR("Maze file ended after %lu of %lu rows",(unsigned long)writer->rows_written,(unsigned long)writer->header.dim_y);
+
+    flush_maze_file(writer);
+
+    // pipes can't go back to the header, their files just have no hash
+    writer->header.hash = writer->hash;
+    writer->header.flags |= MAZE_FILE_HASHED;
+    if(lseek(writer->fd,0,SEEK_CUR) >= 0){
+        if(pwrite(writer->fd,&writer->header,sizeof(maze_file_header_t),0) != sizeof(maze_file_header_t))
+            PERROR("Couldn't write maze file header");
+    }
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+
+
+void write_maze_file(maze_t maze, const char *path, maze_file_info_t info){
+    int fd = open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd < 0) PERROR("Couldn't open %s to write the maze",path);
+
+    maze_file_writer_t writer;
+    begin_maze_file(&writer,fd,maze.dimensions.x,maze.dimensions.y,info);
+    for(uint64_t y = 0 ; y < maze.dimensions.y ; ++y)
+        write_maze_file_row(&writer,&maze_at(maze,0,y));
+    end_maze_file(&writer);
+    close(fd);
+}
+
+
+
+maze_file_t map_maze_file(const char *path){
+    maze_file_t file;
+    int fd = open(path,O_RDONLY);
+    if(fd < 0) PERROR("Couldn't open maze file %s",path);
+
+    struct stat info;
+    if(fstat(fd,&info) != 0) PERROR("Couldn't stat maze file %s",path);
+    if((size_t)info.st_size < sizeof(maze_file_header_t)) PERROR("%s is too small to be a maze file",path);
+
+    // the header is checked before anything is mapped: the dimensions must
+    // fit a maze_t and the rows the size of the file
+    maze_file_header_t header;
+    if(pread(fd,&header,sizeof(maze_file_header_t),0) != sizeof(maze_file_header_t))
+        PERROR("Couldn't read maze file header of %s",path);
+    if(memcmp(header.magic,MAZE_FILE_MAGIC,4) != 0) PERROR("%s is not a maze file",path);
+    if(header.version != MAZE_FILE_VERSION) PERROR("Unsupported maze file version %u in %s",header.version,path);
+    if(header.dim_x == 0 || header.dim_y == 0 || header.dim_x > UINT32_MAX || header.dim_y > UINT32_MAX)
+        PERROR("Unsupported maze file dimensions %lu x %lu in %s",(unsigned long)header.dim_x,(unsigned long)header.dim_y,path);
+    if(header.row_bytes != maze_file_row_bytes(header.dim_x)) PERROR("Corrupted maze file header in %s",path);
+    if(header.dim_y > ((size_t)info.st_size - sizeof(maze_file_header_t))/header.row_bytes)
+        PERROR("Maze file %s is truncated",path);
+
+    file.mapping_size = info.st_size;
+    file.mapping = mmap(NULL,file.mapping_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(file.mapping == MAP_FAILED) PERROR("Couldn't map maze file %s",path);
+
+    file.header = (const maze_file_header_t*) file.mapping;
+    file.cells = (const uint8_t*) file.mapping + sizeof(maze_file_header_t);
+    file.dimensions = (vec2_t){(int_t)header.dim_x,(int_t)header.dim_y};
+    file.row_bytes = header.row_bytes;
+    madvise(file.mapping,file.mapping_size,MADV_SEQUENTIAL);
+    return file;
+}
+
+
+
+void unmap_maze_file(maze_file_t *file){
+    munmap(file->mapping,file->mapping_size);
+    file->mapping = NULL;
+    file->cells = NULL;
+    file->header = NULL;
+}
+
+
+
+// each worker unpacks (when target.data is not NULL) and hashes a band of rows
+typedef struct{
+    maze_file_t *file;
+    maze_t target;
+    uint64_t *row_hashes;
+    uint64_t first_row, last_row;
+    uint8_t worker_id, workers;
+} _maze_file_band_args_t;
+static void * _maze_file_band_thread(void *void_args){
+    _maze_file_band_args_t *args = (_maze_file_band_args_t*) void_args;
+    maze_file_t *file = args->file;
+    pin_worker(args->worker_id,args->workers);
+    for(uint64_t y = args->first_row ; y < args->last_row ; ++y){
+        const uint8_t *packed = file->cells + y*file->row_bytes;
+        args->row_hashes[y] = maze_file_row_hash(packed,file->row_bytes);
+        if(!args->target.data) continue;
+
+        maze_vertex_t *row = &maze_at(args->target,0,y);
+        uint64_t x = 0;
+        for(; x + 1 < file->dimensions.x ; x += 2){
+            row[x].open_directions = packed[x>>1] & 0xF;
+            row[x+1].open_directions = packed[x>>1] >> 4;
+        }
+        if(x < file->dimensions.x)
+            row[x].open_directions = packed[x>>1] & 0xF;
+    }
+    return NULL;
+}
+static bool process_maze_file(maze_file_t *file, maze_t target, uint8_t workers){
+    if(workers < 1) workers = 1;
+    uint64_t rows = file->dimensions.y;
+    uint64_t *row_hashes = (uint64_t*) malloc(rows*sizeof(uint64_t));
+    pthread_t *tid = (pthread_t*) calloc(workers,sizeof(pthread_t));
+    _maze_file_band_args_t *args = (_maze_file_band_args_t*) calloc(workers,sizeof(_maze_file_band_args_t));
+    if(!row_hashes || !tid || !args) PERROR("Couldn't allocate space to read maze file");
+
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i].file = file;
+        args[i].target = target;
+        args[i].row_hashes = row_hashes;
+        args[i].first_row = rows*i/workers;
+        args[i].last_row = rows*(i+1)/workers;
+        args[i].worker_id = i;
+        args[i].workers = workers;
+        pthread_create(&tid[i],NULL,_maze_file_band_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for(uint64_t y = 0 ; y < rows ; ++y)
+        hash = fold_row_hash(hash,row_hashes[y]);
+    bool valid = !(file->header->flags & MAZE_FILE_HASHED) || hash == file->header->hash;
+
+    free(row_hashes);
+    free(tid);
+    free(args);
+    return valid;
+}
+
+
+
+bool verify_maze_file(maze_file_t file, uint8_t workers){
+    maze_t no_target;
+    no_target.data = NULL;
+    return process_maze_file(&file,no_target,workers);
+}
+
+
+
+maze_t load_maze_file(const char *path, maze_file_info_t *info, uint8_t workers){
+    maze_file_t file = map_maze_file(path);
+    madvise(file.mapping,file.mapping_size,MADV_WILLNEED);
+
+    maze_t maze;
+    alloc_maze(&maze,file.dimensions.x,file.dimensions.y);
+    if(!process_maze_file(&file,maze,workers)){
+        free(maze.data);
+        PERROR("Maze file %s doesn't match its hash",path);
+    }
+    if(info){
+        info->generator = file.header->generator;
+        info->seed = file.header->seed;
+    }
+    unmap_maze_file(&file);
+    return maze;
+}
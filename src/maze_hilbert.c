@@ -1,7 +1,12 @@
 #include "common.h"
 #include "maze.h"
 #include "special_characters.h"
+#include "random.h"
+#include "topology.h"
+#include "path_index.h"
 #include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 
 // Hilbert Curve:
@@ -15,539 +20,370 @@
 // │  └──┘  │    
 // └──┐  ┌──┘  
 // ───┘  └───    
+//
+// The curve starts at the top left, goes down first and ends at the top
+// right. Every cell opens towards one of its neighbours with a higher
+// index along the curve, so following the curve backwards from any cell
+// always reaches the start: the maze is a tree.
+
+
+
+// index of the cell (x,y) along the Hilbert curve covering a side x side
+// square, side being a power of two
+static uint64_t hilbert_index(uint64_t side, uint64_t x, uint64_t y){
+    uint64_t index = 0;
+    for(uint64_t s = side/2 ; s > 0 ; s /= 2){
+        uint64_t rx = (x & s) > 0;
+        uint64_t ry = (y & s) > 0;
+        index += s*s*((3*rx) ^ ry);
+        // rotate the quadrant so the sub-curve is in the standard orientation
+        if(ry == 0){
+            if(rx == 1){
+                x = s-1 - (x & (s-1));
+                y = s-1 - (y & (s-1));
+            }
+            uint64_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return index;
+}
 
 
 
-typedef struct{
-    uint64_t *data;
-    uint64_t start;
-    uint64_t original_side;
-    uint64_t side;
-}hilbert_curve_t;
-#define hc_at(hc,_x,_y)  ((hc).data[(hc).start+(_x)+(_y)*(hc).original_side])
-#define hc_pos(hc,_x,_y) ((_x)+(_y)*(hc).original_side)
-
-
-// static void print_hilbert_curve(hilbert_curve_t hc){
-//     for(int i = 0 ; i < hc.side ; ++i){
-//         for(int j = 0 ; j < hc.side ; ++j){
-//             printf("%03"PRIu64" ", hc_at(hc,j,i));
-//         }                
-//         printf("\n");
-//     }
-// }
-
-static hilbert_curve_t hilbert_curve_of_order(uint8_t order);
-
-// there are eight different variations of the 
-// hillbert curve fill, based on the
-// order the quadrants that are filled 
-// and the orientation:
-
-// A:
-// ↓ •     
-// → ↑ 
-static void hillbert_curve_fill_A(hilbert_curve_t hc,uint64_t start_index);
-
-// B:
-// → •     
-// ↑ ←    
-static void hillbert_curve_fill_B(hilbert_curve_t hc,uint64_t start_index);
-
-// C:
-// • ←
-// → ↑
-static void hillbert_curve_fill_C(hilbert_curve_t hc,uint64_t start_index);
-
-// D:
-// • ↓
-// ↑ ←      
-static void hillbert_curve_fill_D(hilbert_curve_t hc,uint64_t start_index);
-
-// E:
-// → ↓
-// • ←  
-static void hillbert_curve_fill_E(hilbert_curve_t hc,uint64_t start_index);
-
-// F:
-// ↓ ←
-// • ↑ 
-static void hillbert_curve_fill_F(hilbert_curve_t hc,uint64_t start_index);
-
-// G:
-// → ↓
-// ↑ •     
-static void hillbert_curve_fill_G(hilbert_curve_t hc,uint64_t start_index);
-
-// H:
-// ↓ ←
-// → •        
-static void hillbert_curve_fill_H(hilbert_curve_t hc,uint64_t start_index);
-
-
-
-static void hillbert_curve_fill_A(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// A:
-// ↓ •     
-// → ↑ 
-// E -> A -> A -> B
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    TL_start = start_index+0*quadrant_size;
-    BL_start = start_index+1*quadrant_size;
-    BR_start = start_index+2*quadrant_size;
-    TR_start = start_index+3*quadrant_size;
-    
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_E(TL,TL_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_A(BL,BL_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_A(BR,BR_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_B(TR,TR_start);
-    
+static void hilbert_row(uint64_t dim_x, uint64_t dim_y, uint64_t y, uint64_t *indices){
+    (void) dim_y;
+    for(uint64_t x = 0 ; x < dim_x ; ++x)
+        indices[x] = hilbert_index(dim_x,x,y);
 }
 
-static void hillbert_curve_fill_B(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// B:
-// → •     
-// ↑ ←     
-// F -> B -> B -> A 
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    BR_start = start_index+0*quadrant_size;
-    BL_start = start_index+1*quadrant_size;
-    TL_start = start_index+2*quadrant_size;
-    TR_start = start_index+3*quadrant_size;
-    
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_F(BR,BR_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_B(BL,BL_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_B(TL,TL_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_A(TR,TR_start);
-    
-}
 
-static void hillbert_curve_fill_C(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// C:
-// • ←
-// → ↑  
-// G -> C -> C -> D  
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    BL_start = start_index+0*quadrant_size;
-    BR_start = start_index+1*quadrant_size;
-    TR_start = start_index+2*quadrant_size;
-    TL_start = start_index+3*quadrant_size;
-    
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_G(BL,BL_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_C(BR,BR_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_C(TR,TR_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_D(TL,TL_start);
-    
+
+// Generalized Hilbert ("gilbert") curve: covers any dim_x x dim_y rectangle
+// splitting it in halves and thirds the way the Hilbert curve splits its
+// square in quadrants. Starts at the top left and ends at the top right
+// corner when dim_x >= dim_y (bottom left otherwise); consecutive cells are
+// neighbours except for a single diagonal step in some odd x even shapes.
+// a and b are the major and minor axis of the current block, as vectors.
+
+static inline int64_t sign(int64_t v){
+    return (v > 0) - (v < 0);
 }
 
-static void hillbert_curve_fill_D(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// D:
-// • ↓
-// ↑ ←
-// H -> D -> D -> C   
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    TR_start = start_index+0*quadrant_size;
-    BR_start = start_index+1*quadrant_size;
-    BL_start = start_index+2*quadrant_size;
-    TL_start = start_index+3*quadrant_size;
-    
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_H(TR,TR_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_D(BR,BR_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_D(BL,BL_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_C(TL,TL_start);
-    
-
-    
+// floor(v/2): the split points must round the same way whatever the
+// orientation of the block
+static inline int64_t floor_half(int64_t v){
+    return v >= 0 ? v/2 : -((1-v)/2);
 }
 
-static void hillbert_curve_fill_E(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// E:
-// → ↓
-// • ←
-// A -> E -> E -> F
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    TL_start = start_index+0*quadrant_size;
-    TR_start = start_index+1*quadrant_size;
-    BR_start = start_index+2*quadrant_size;
-    BL_start = start_index+3*quadrant_size;
-    
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_A(TL,TL_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_E(TR,TR_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_E(BR,BR_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_F(BL,BL_start);
-    
+// whether (x,y) lies in the block of corner (x0,y0) spanned by a and b
+static inline bool in_block(int64_t x, int64_t y, int64_t x0, int64_t y0,
+                            int64_t ax, int64_t ay, int64_t bx, int64_t by){
+    int64_t dx = ax+bx, dy = ay+by;
+    if(dx < 0 ? (x > x0 || x <= x0+dx) : (x < x0 || x >= x0+dx)) return false;
+    if(dy < 0 ? (y > y0 || y <= y0+dy) : (y < y0 || y >= y0+dy)) return false;
+    return true;
 }
 
-static void hillbert_curve_fill_F(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
+// block of the curve: corner, major and minor axis and index of its first cell
+typedef struct{
+    int64_t x0, y0, ax, ay, bx, by;
+    uint64_t index;
+} gilbert_block_t;
+
+// index of the cell (x,y) along the gilbert curve. blocks holds the nested
+// blocks containing the previous cell, depth of them: the descent restarts
+// from the innermost one that still contains (x,y), so the cells of a row
+// cost a couple of steps each instead of a whole descent
+static uint64_t gilbert_index(gilbert_block_t *blocks, int *depth, int64_t x, int64_t y){
+    while(*depth > 1){
+        gilbert_block_t *k = &blocks[*depth-1];
+        if(in_block(x,y,k->x0,k->y0,k->ax,k->ay,k->bx,k->by)) break;
+        --*depth;
     }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// F:
-// ↓ ←
-// • ↑
-// B -> F -> F -> E      
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    BR_start = start_index+0*quadrant_size;
-    TR_start = start_index+1*quadrant_size;
-    TL_start = start_index+2*quadrant_size;
-    BL_start = start_index+3*quadrant_size;
-    
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_B(BR,BR_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_F(TR,TR_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_F(TL,TL_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_E(BL,BL_start);
-    
-}
 
-static void hillbert_curve_fill_G(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
+    while(true){
+        gilbert_block_t k = blocks[*depth-1];
+        int64_t w = llabs(k.ax+k.ay), h = llabs(k.bx+k.by);
+        int64_t dax = sign(k.ax), day = sign(k.ay), dbx = sign(k.bx), dby = sign(k.by);
+        if(h == 1) return k.index + dax*(x-k.x0) + day*(y-k.y0);
+        if(w == 1) return k.index + dbx*(x-k.x0) + dby*(y-k.y0);
+
+        int64_t ax2 = floor_half(k.ax), ay2 = floor_half(k.ay);
+        int64_t bx2 = floor_half(k.bx), by2 = floor_half(k.by);
+        int64_t w2 = llabs(ax2+ay2), h2 = llabs(bx2+by2);
+        gilbert_block_t *next = &blocks[(*depth)++];
+
+        if(2*w > 3*h){
+            // long block: split the major axis in two
+            if((w2 % 2) && w > 2){ ax2 += dax; ay2 += day; }
+            if(in_block(x,y,k.x0,k.y0,ax2,ay2,k.bx,k.by))
+                *next = (gilbert_block_t){k.x0,k.y0,ax2,ay2,k.bx,k.by,k.index};
+            else
+                *next = (gilbert_block_t){k.x0+ax2,k.y0+ay2,k.ax-ax2,k.ay-ay2,k.bx,k.by,
+                                          k.index+llabs((ax2+ay2)*(k.bx+k.by))};
+            continue;
+        }
+
+        // one step along the minor axis, one along the major, one back
+        if((h2 % 2) && h > 2){ bx2 += dbx; by2 += dby; }
+        uint64_t index = k.index;
+        if(in_block(x,y,k.x0,k.y0,bx2,by2,ax2,ay2)){
+            *next = (gilbert_block_t){k.x0,k.y0,bx2,by2,ax2,ay2,index};
+            continue;
+        }
+        index += llabs((bx2+by2)*(ax2+ay2));
+        if(in_block(x,y,k.x0+bx2,k.y0+by2,k.ax,k.ay,k.bx-bx2,k.by-by2)){
+            *next = (gilbert_block_t){k.x0+bx2,k.y0+by2,k.ax,k.ay,k.bx-bx2,k.by-by2,index};
+            continue;
+        }
+        index += llabs((k.ax+k.ay)*((k.bx-bx2)+(k.by-by2)));
+        *next = (gilbert_block_t){k.x0+(k.ax-dax)+(bx2-dbx),k.y0+(k.ay-day)+(by2-dby),
+                                  -bx2,-by2,-(k.ax-ax2),-(k.ay-ay2),index};
     }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// G:
-// → ↓
-// ↑ •
-// C -> G -> G -> H     
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    BL_start = start_index+0*quadrant_size;
-    TL_start = start_index+1*quadrant_size;
-    TR_start = start_index+2*quadrant_size;
-    BR_start = start_index+3*quadrant_size;
-    
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_C(BL,BL_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_G(TL,TL_start);
-    
-
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_G(TR,TR_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_H(BR,BR_start);
-    
 }
 
-static void hillbert_curve_fill_H(hilbert_curve_t hc,uint64_t start_index){
-    if(hc.side==1){
-        hc_at(hc,0,0) = start_index;
-        return;
-    }
-    uint64_t half_side = hc.side/2;
-    uint64_t quadrant_size =  half_side*half_side;
-    
-// H:
-// ↓ ←
-// → •  
-// D -> H -> H -> G
-
-    hilbert_curve_t TL,BL,BR,TR;
-    uint64_t TL_start,BL_start,BR_start,TR_start;
-
-    TR_start = start_index+0*quadrant_size;
-    TL_start = start_index+1*quadrant_size;
-    BL_start = start_index+2*quadrant_size;
-    BR_start = start_index+3*quadrant_size;
-    
-    TR=hc;
-    TR.side  = half_side;
-    TR.start = hc.start + half_side;
-    hillbert_curve_fill_D(TR,TR_start);
-    
-
-    TL=hc;
-    TL.side  = half_side;
-    hillbert_curve_fill_H(TL,TL_start);
-    
-
-    BL=hc;
-    BL.side=half_side;
-    BL.start = hc.start+half_side*hc.original_side;
-    hillbert_curve_fill_H(BL,BL_start);
-    
-
-    BR=hc;
-    BR.side  = half_side;
-    BR.start = hc.start+half_side*hc.original_side+half_side;
-    hillbert_curve_fill_G(BR,BR_start);
-    
+// every split halves at least one side of a block, so 2*64 levels are
+// more than any 64-bit dimensions need
+#define GILBERT_MAX_DEPTH 128
+
+static void gilbert_row(uint64_t dim_x, uint64_t dim_y, uint64_t y, uint64_t *indices){
+    gilbert_block_t blocks[GILBERT_MAX_DEPTH];
+    if(dim_x >= dim_y) blocks[0] = (gilbert_block_t){0,0,dim_x,0,0,dim_y,0};
+    else blocks[0] = (gilbert_block_t){0,0,0,dim_y,dim_x,0,0};
+    int depth = 1;
+    for(uint64_t x = 0 ; x < dim_x ; ++x)
+        indices[x] = gilbert_index(blocks,&depth,x,y);
 }
 
 
-// build a hilbert curve of order n
-static hilbert_curve_t hilbert_curve_of_order(uint8_t order){
-    hilbert_curve_t hc;
-    hc.original_side = 1<<order;
-    hc.side = hc.original_side;
-    hc.start=0;
-    hc.data = (uint64_t*) calloc(hc.side*hc.side,sizeof(uint64_t));
-    if (!hc.data) PERROR("Couldn't allocate space for hillbert curve of size %"PRIu64" x %"PRIu64"",hc.side,hc.side);
 
-    hillbert_curve_fill_A(hc,0);
-    
+// Rows are built in bands, one per worker. A cell's direction is chosen
+// with a random number keyed by the cell, so any worker can tell which way
+// a neighbour in another band opened: every worker writes only its own
+// cells, pulling the passages its neighbours open towards them.
+// Each worker keeps the last three rows of curve indices and of chosen
+// directions, a few bytes per column.
+//
+// Where the curve steps diagonally from a cell to the next one the cell may
+// have no neighbour further along the curve. It then opens towards the
+// corner between the two, in its own row, and that corner always opens
+// towards the cell after the diagonal step when it can: the stranded cell
+// joins a branch that doesn't come back to it and the maze stays a tree.
+// fills indices with the curve indices of the cells of row y
+typedef void (*curve_row_t)(uint64_t dim_x, uint64_t dim_y, uint64_t y, uint64_t *indices);
 
-    return hc;
+typedef struct{
+    maze_t maze;
+    curve_row_t curve_row;
+    bool diagonal_steps;        // whether the curve may step diagonally
+    uint64_t seed;
+    path_index_t *index;        // where the chosen directions go as parents, if not NULL
+    int_t first_row, last_row;
+    uint8_t id, workers;
+} _lookahead_band_args_t;
+
+typedef struct{
+    uint64_t *indices[3];       // curve indices of rows r-1, r and r+1 by r%3
+    direction_t *chosen[3];     // directions chosen by the cells of a row, by row%3
+    int64_t last_index_row;     // last row of indices computed
+} _lookahead_rows_t;
+
+static void lookahead_index_row(_lookahead_rows_t *rows, _lookahead_band_args_t *args, int64_t row){
+    args->curve_row(args->maze.dimensions.x,args->maze.dimensions.y,row,rows->indices[row%3]);
+    rows->last_index_row = row;
 }
 
-static maze_t get_maze_from_hilbert_curve(hilbert_curve_t hc){
-    maze_t maze;
-    alloc_maze(&maze,hc.side,hc.side);
-    for(uint64_t y = 0 ; y < hc.side ; ++y){
-        for(uint64_t x = 0 ; x < hc.side ; ++x){
-            direction_t available = NORTH|EAST|SOUTH|WEST;
-
-            // can't open to outside of the maze
-            if(x==0) available &= ~WEST;
-            if(x==hc.side-1) available &= ~EAST;
-            if(y==0) available &= ~NORTH;
-            if(y==hc.side-1) available &= ~SOUTH;
-
-            // can't open to neighbors with lower hilbert index
-            uint64_t this_hilbert_idx = hc_at(hc,x,y);
-            if(available&WEST){
-                uint64_t west_neighbor = hc_at(hc,x-1,y);
-                if(west_neighbor<this_hilbert_idx)
-                    available &= ~WEST;
-            }
-            if(available&NORTH){
-                uint64_t north_neighbor = hc_at(hc,x,y-1);
-                if(north_neighbor<this_hilbert_idx)
-                    available &= ~NORTH;
-            }
-            if(available&EAST){
-                uint64_t east_neighbor = hc_at(hc,x+1,y);
-                if(east_neighbor<this_hilbert_idx)
-                    available &= ~EAST;
+// direction a cell stranded by a diagonal step opens towards, 0 if none
+static direction_t lookahead_diagonal_corner(uint64_t *above, uint64_t *below, uint64_t x, uint64_t dim_x, uint64_t next){
+    for(int d = 0 ; d < 2 ; ++d){
+        uint64_t *row = d ? below : above;
+        if(!row) continue;
+        if(x > 0 && row[x-1] == next) return WEST;
+        if(x+1 < dim_x && row[x+1] == next) return EAST;
+    }
+    return 0;
+}
+
+// direction chosen by each cell of a row, among the neighbours further
+// along the curve
+static void lookahead_choose_row(_lookahead_rows_t *rows, _lookahead_band_args_t *args, int64_t row){
+    uint64_t dim_x = args->maze.dimensions.x, dim_y = args->maze.dimensions.y;
+    while(rows->last_index_row < row+1 && rows->last_index_row+1 < (int64_t)dim_y)
+        lookahead_index_row(rows,args,rows->last_index_row+1);
+
+    uint64_t *above = row > 0 ? rows->indices[(row-1)%3] : NULL;
+    uint64_t *here = rows->indices[row%3];
+    uint64_t *below = row+1 < (int64_t)dim_y ? rows->indices[(row+1)%3] : NULL;
+    direction_t *chosen = rows->chosen[row%3];
+    for(uint64_t x = 0 ; x < dim_x ; ++x){
+        uint64_t this_curve_idx = here[x];
+        direction_t available = 0;
+        if(x > 0 && here[x-1] > this_curve_idx) available |= WEST;
+        if(x+1 < dim_x && here[x+1] > this_curve_idx) available |= EAST;
+        if(above && above[x] > this_curve_idx) available |= NORTH;
+        if(below && below[x] > this_curve_idx) available |= SOUTH;
+
+        if(args->diagonal_steps){
+            if(!available && this_curve_idx+1 < dim_x*dim_y){
+                chosen[x] = lookahead_diagonal_corner(above,below,x,dim_x,this_curve_idx+1);
+                continue;
             }
-            if(available&SOUTH){
-                uint64_t west_neighbor = hc_at(hc,x,y+1);
-                if(west_neighbor<this_hilbert_idx)
-                    available &= ~SOUTH;
+            // corner of a diagonal step: the step goes from a horizontal
+            // neighbour to the next cell, a vertical one
+            direction_t forced = 0;
+            for(int side = 0 ; side < 2 && !forced ; ++side){
+                if(side ? x+1 >= dim_x : x == 0) continue;
+                uint64_t from = side ? here[x+1] : here[x-1];
+                if(above && above[x] == from+1 && (available & NORTH)) forced = NORTH;
+                if(below && below[x] == from+1 && (available & SOUTH)) forced = SOUTH;
             }
-            if(available == 0 ) continue;
-            direction_t randomized_direction =  random_direction(available);
-            maze_at(maze,x,y).open_directions |= randomized_direction;
-            switch (randomized_direction){
-                case WEST:
-                maze_at(maze,x-1,y).open_directions |= EAST;
-                break;
-                case NORTH:
-                maze_at(maze,x,y-1).open_directions |= SOUTH;
-                break;
-                case EAST:
-                maze_at(maze,x+1,y).open_directions |= WEST;
-                break;
-                case SOUTH:
-                maze_at(maze,x,y+1).open_directions |= NORTH;
-                break;
-
-            default:
-                break;
+            if(forced){
+                chosen[x] = forced;
+                continue;
             }
-            // printf("\n\nAt: %"PRIu64",%"PRIu64"\n",y,x);
-            // printf("Available directions are: ");
-            // print_direction(available);
-            
         }
-        // printf("\n");
+        chosen[x] = keyed_random_direction(args->seed,x+row*dim_x,available);
+    }
+}
 
+// Every cell points to the neighbour it chose, further along the curve, so
+// the chosen directions are the parents of a tree rooted at the end of the
+// curve. Four cells share a byte of the index: the bytes on the edges of
+// the band may be shared with the next band and are ORed atomically
+static void lookahead_index_parents(_lookahead_band_args_t *args, int64_t y, direction_t *chosen){
+    path_index_t *index = args->index;
+    uint64_t dim_x = args->maze.dimensions.x;
+    index_t band_first = (index_t)args->first_row*dim_x, band_end = (index_t)args->last_row*dim_x;
+    index_t row_first = y*dim_x, row_end = row_first + dim_x;
+    uint8_t bits = 0;
+    for(index_t i = row_first ; i < row_end ; ++i){
+        direction_t direction = chosen[i - row_first];
+        if(direction) bits |= __builtin_ctz(direction) << ((i & 3) << 1);
+        else index->root = i;
+        if((i & 3) != 3 && i+1 < row_end) continue;
+        index_t byte = i >> 2;
+        if(byte << 2 < band_first || (byte << 2) + 4 > band_end)
+            atomic_fetch_or((_Atomic uint8_t*)&index->parents[byte],bits);
+        else
+            index->parents[byte] |= bits;
+        bits = 0;
     }
+}
+
+static void * _lookahead_band_thread(void *void_args){
+    _lookahead_band_args_t *args = (_lookahead_band_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    uint64_t dim_x = args->maze.dimensions.x, dim_y = args->maze.dimensions.y;
+
+    _lookahead_rows_t rows;
+    for(int i = 0 ; i < 3 ; ++i){
+        rows.indices[i] = (uint64_t*) malloc(dim_x*sizeof(uint64_t));
+        rows.chosen[i] = (direction_t*) malloc(dim_x*sizeof(direction_t));
+        if(!rows.indices[i] || !rows.chosen[i])
+            PERROR("Couldn't allocate rows for lookahead generation with width %"PRIu64"",dim_x);
+    }
+
+    // the rows before the band are needed for its first row
+    int64_t first = args->first_row;
+    rows.last_index_row = first > 1 ? first-3 : -1;
+    if(first > 0) lookahead_choose_row(&rows,args,first-1);
+    lookahead_choose_row(&rows,args,first);
+
+    for(int64_t y = first ; y < args->last_row ; ++y){
+        if(y+1 < (int64_t)dim_y) lookahead_choose_row(&rows,args,y+1);
+        direction_t *above = y > 0 ? rows.chosen[(y-1)%3] : NULL;
+        direction_t *here = rows.chosen[y%3];
+        direction_t *below = y+1 < (int64_t)dim_y ? rows.chosen[(y+1)%3] : NULL;
+        for(uint64_t x = 0 ; x < dim_x ; ++x){
+            direction_t open = here[x];
+            if(x > 0 && here[x-1] == EAST) open |= WEST;
+            if(x+1 < dim_x && here[x+1] == WEST) open |= EAST;
+            if(above && above[x] == SOUTH) open |= NORTH;
+            if(below && below[x] == NORTH) open |= SOUTH;
+            maze_at(args->maze,x,y).open_directions = open;
+        }
+        if(args->index) lookahead_index_parents(args,y,here);
+    }
+
+    for(int i = 0 ; i < 3 ; ++i){
+        free(rows.indices[i]);
+        free(rows.chosen[i]);
+    }
+    return NULL;
+}
+
+// bands of rows go to workers threads, the maze doesn't depend on workers
+static maze_t generate_random_maze_lookahead(int_t dim_x, int_t dim_y, curve_row_t curve_row, bool diagonal_steps,
+                                             uint64_t seed, path_index_t *index, uint8_t workers){
+    if(workers == 0) workers = 1;
+    if(workers > dim_y) workers = dim_y;
+    maze_t maze;
+    alloc_maze_for_workers(&maze,dim_x,dim_y,workers);
+    if(index) alloc_path_index(index,dim_x,dim_y);
+
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _lookahead_band_args_t *args = calloc(workers,sizeof(_lookahead_band_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while generating maze with lookahead.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_lookahead_band_args_t){maze,curve_row,diagonal_steps,seed,index,
+                                           (uint64_t)dim_y*i/workers,(uint64_t)dim_y*(i+1)/workers,i,workers};
+        pthread_create(&tid[i],NULL,_lookahead_band_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+    free(tid);
+    free(args);
+    if(index) path_index_depths(index);
     return maze;
 }
 
-maze_t generate_random_maze_hillbert_lookahead(uint64_t side){
-    uint8_t order = log2f(side);
-    if(log2l(side)!= order)
+
+
+static void check_hilbert_side(uint64_t side){
+    if(side == 0 || (side & (side-1)))
         PERROR("Can only generate random mazes with hillbert lookahead with sides as powers of 2.");
-    hilbert_curve_t hc = hilbert_curve_of_order(order);
-    maze_t maze = get_maze_from_hilbert_curve(hc);
-    return maze;
+}
+
+maze_t generate_random_maze_hillbert_lookahead(uint64_t side, uint8_t workers, uint64_t seed){
+    check_hilbert_side(side);
+    return generate_random_maze_lookahead(side,side,hilbert_row,false,seed,NULL,workers);
+}
+
+maze_t generate_random_maze_hillbert_lookahead_indexed(uint64_t side, uint8_t workers, uint64_t seed,
+                                                      path_index_t *index){
+    check_hilbert_side(side);
+    return generate_random_maze_lookahead(side,side,hilbert_row,false,seed,index,workers);
+}
+
+// the curve ends on the other corner of the major side: when that side is
+// odd and the minor one even, both ends have the same colour on a
+// checkerboard and a diagonal step is unavoidable
+static bool gilbert_diagonal_steps(int_t dim_x, int_t dim_y){
+    if(dim_x == 0 || dim_y == 0)
+        PERROR("Can't generate a maze with gilbert lookahead of size %ux%u.",dim_x,dim_y);
+    int_t major = dim_x >= dim_y ? dim_x : dim_y;
+    int_t minor = dim_x >= dim_y ? dim_y : dim_x;
+    return (major % 2) && !(minor % 2);
+}
+
+maze_t generate_random_maze_gilbert_lookahead(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed){
+    return generate_random_maze_lookahead(dim_x,dim_y,gilbert_row,gilbert_diagonal_steps(dim_x,dim_y),seed,NULL,workers);
+}
+
+maze_t generate_random_maze_gilbert_lookahead_indexed(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed,
+                                                      path_index_t *index){
+    return generate_random_maze_lookahead(dim_x,dim_y,gilbert_row,gilbert_diagonal_steps(dim_x,dim_y),seed,index,workers);
 }
 
 // test hilbert functions
 void test_hilbert(){
     clock_t start = clock();
-    hilbert_curve_t hc = hilbert_curve_of_order(13);
-    // print_hilbert_curve(hc);
-    maze_t maze = get_maze_from_hilbert_curve(hc);
+    maze_t maze = generate_random_maze_hillbert_lookahead(1<<13,CPU_CORES,0);
     clock_t end = clock();
     float seconds = (float)(end - start) / CLOCKS_PER_SEC;
     printf("finished after %.4fs...\n",seconds);
     print_maze(maze);
-    free(hc.data);
+    free(maze.data);
 }
@@ -0,0 +1,346 @@
+#include "maze.h"
+#include "common.h"
+#include "topology.h"
+#include "random.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <inttypes.h>
+
+// Kruskal's algorithm: every passage between two neighbouring cells gets a
+// random weight and the passages are opened from the lightest one on,
+// skipping the ones that would join cells already connected.
+//
+// The weight of a passage is a keyed random number of its id, so it doesn't
+// depend on who computes it. A passage is a 64 bit key: the high bits are
+// its weight and the low ones its id, 2*cell for the passage to the east of
+// the cell and 2*cell+1 for the one to the south. The keys are sorted in
+// parallel, bucketed by their top bits and each bucket sorted on its own.
+//
+// The sorted passages are then accepted with deterministic reservations, a
+// window of them at a time: every passage in the window finds the roots of
+// its two cells and reserves both with its position in the order (the
+// smallest position wins). A passage holding the reservation of one of its
+// roots links that root to the other one; passages joining cells already
+// connected are dropped and the rest wait for the next round. Whatever the
+// number of workers, the maze is the one sequential Kruskal would build.
+
+// passages looked at in a round
+#define KRUSKAL_WINDOW (1<<16)
+// at most 2^KRUSKAL_BUCKET_BITS buckets for the sort
+#define KRUSKAL_BUCKET_BITS 16
+
+#define NO_RESERVATION ((index_t)-1)
+
+typedef struct{
+    maze_t maze;
+    uint64_t seed;
+    uint8_t workers;
+    pthread_barrier_t barrier;
+
+    uint64_t *keys, *sorted;
+    index_t number_of_keys;
+    uint8_t id_bits, bucket_bits;
+    index_t *bucket_counts;         // workers x buckets, then their offsets
+    atomic_uint next_bucket;
+
+    _Atomic index_t *parent;        // union find over the cells
+    _Atomic index_t *reserved;      // position of the passage holding a root
+    index_t *window[2];             // positions in sorted, by round parity
+    index_t *roots;                 // roots of the two cells of a window slot
+    bool *pending;                  // whether a window slot is still undecided
+    index_t window_size, next_key, accepted;
+    index_t survivors_end, fresh_start; // where the next window's parts start
+    index_t *survivors, *newly_accepted; // per worker
+    bool finished;
+} _kruskal_t;
+
+typedef struct{
+    _kruskal_t *kruskal;
+    uint8_t id;
+} _kruskal_args_t;
+
+
+
+static inline index_t kruskal_find(_Atomic index_t *parent, index_t cell){
+    while(true){
+        index_t up = atomic_load_explicit(&parent[cell],memory_order_relaxed);
+        if(up == cell) return cell;
+        index_t upper = atomic_load_explicit(&parent[up],memory_order_relaxed);
+        // path halving: every value on the way is an ancestor, so racing
+        // finds only ever shorten each other's paths
+        if(upper != up) atomic_store_explicit(&parent[cell],upper,memory_order_relaxed);
+        cell = upper;
+    }
+}
+
+static inline void reserve(_Atomic index_t *reserved, index_t root, index_t position){
+    index_t current = atomic_load_explicit(&reserved[root],memory_order_relaxed);
+    while(position < current &&
+          !atomic_compare_exchange_weak_explicit(&reserved[root],&current,position,
+                                                 memory_order_relaxed,memory_order_relaxed));
+}
+
+// the two cells of a passage, as indices in the maze data
+static inline void passage_cells(_kruskal_t *k, uint64_t key, index_t *from, index_t *to, bool *south){
+    uint64_t id = key & (((uint64_t)1 << k->id_bits)-1);
+    *from = id >> 1;
+    *south = id & 1;
+    *to = *from + (*south ? k->maze.dimensions.x : 1);
+}
+
+static inline void open_passage(_kruskal_t *k, uint64_t key){
+    index_t from, to;
+    bool south;
+    passage_cells(k,key,&from,&to,&south);
+    // two passages of a cell can be accepted in the same round
+    atomic_fetch_or_explicit((_Atomic direction_t*)&k->maze.data[from].open_directions,
+                             south ? SOUTH : EAST,memory_order_relaxed);
+    atomic_fetch_or_explicit((_Atomic direction_t*)&k->maze.data[to].open_directions,
+                             south ? NORTH : WEST,memory_order_relaxed);
+}
+
+static inline void insertion_sort(uint64_t *keys, index_t count){
+    for(index_t i = 1 ; i < count ; ++i){
+        uint64_t key = keys[i];
+        index_t j = i;
+        for(; j > 0 && keys[j-1] > key ; --j)
+            keys[j] = keys[j-1];
+        keys[j] = key;
+    }
+}
+
+// the keys of a bucket share their top bits and the rest are uniform:
+// spreading them by the next 8 bits leaves runs of a couple of keys, which
+// insertion sort then puts in order in linear time
+static void sort_bucket(uint64_t *keys, index_t count, uint8_t shift, uint64_t *scratch){
+    if(count > 32){
+        index_t offsets[257] = {0};
+        for(index_t i = 0 ; i < count ; ++i)
+            offsets[((keys[i] >> (shift-8)) & 0xFF)+1]++;
+        for(int b = 0 ; b < 256 ; ++b)
+            offsets[b+1] += offsets[b];
+        for(index_t i = 0 ; i < count ; ++i)
+            scratch[offsets[(keys[i] >> (shift-8)) & 0xFF]++] = keys[i];
+        memcpy(keys,scratch,count*sizeof(uint64_t));
+    }
+    insertion_sort(keys,count);
+}
+
+
+
+// keys of the passages of a band of rows, and the union find of its cells
+static void kruskal_make_keys(_kruskal_t *k, uint8_t id){
+    index_t dim_x = k->maze.dimensions.x, dim_y = k->maze.dimensions.y;
+    index_t first_row = dim_y*id/k->workers, last_row = dim_y*(id+1)/k->workers;
+    // every row but the last has dim_x-1 passages to the east and dim_x to the south
+    index_t out = first_row*(2*dim_x-1);
+    uint64_t weight_mask = ~(((uint64_t)1 << k->id_bits)-1);
+    for(index_t y = first_row ; y < last_row ; ++y){
+        for(index_t x = 0 ; x < dim_x ; ++x){
+            index_t cell = x + y*dim_x;
+            atomic_store_explicit(&k->parent[cell],cell,memory_order_relaxed);
+            atomic_store_explicit(&k->reserved[cell],NO_RESERVATION,memory_order_relaxed);
+            if(x+1 < dim_x) k->keys[out++] = (keyed_random(k->seed,2*cell) & weight_mask) | 2*cell;
+            if(y+1 < dim_y) k->keys[out++] = (keyed_random(k->seed,2*cell+1) & weight_mask) | (2*cell+1);
+        }
+    }
+}
+
+static void kruskal_sort(_kruskal_t *k, uint8_t id){
+    index_t buckets = (index_t)1 << k->bucket_bits;
+    uint8_t shift = 64 - k->bucket_bits;
+    index_t first = k->number_of_keys*id/k->workers, last = k->number_of_keys*(id+1)/k->workers;
+    index_t *counts = &k->bucket_counts[id*buckets];
+    for(index_t i = first ; i < last ; ++i)
+        counts[k->keys[i] >> shift]++;
+    pthread_barrier_wait(&k->barrier);
+
+    if(id == 0){
+        // bucket by bucket, worker by worker: each worker scatters its keys
+        // in order after the ones of the previous workers
+        index_t offset = 0;
+        for(index_t b = 0 ; b < buckets ; ++b){
+            for(uint8_t w = 0 ; w < k->workers ; ++w){
+                index_t count = k->bucket_counts[w*buckets+b];
+                k->bucket_counts[w*buckets+b] = offset;
+                offset += count;
+            }
+        }
+    }
+    pthread_barrier_wait(&k->barrier);
+
+    for(index_t i = first ; i < last ; ++i)
+        k->sorted[counts[k->keys[i] >> shift]++] = k->keys[i];
+    pthread_barrier_wait(&k->barrier);
+
+    // after the scatter the last worker's offsets are the ends of the buckets
+    index_t *ends = &k->bucket_counts[(k->workers-1)*buckets];
+    index_t largest = 0;
+    for(index_t b = 0 ; b < buckets ; ++b)
+        if(ends[b] - (b ? ends[b-1] : 0) > largest) largest = ends[b] - (b ? ends[b-1] : 0);
+    uint64_t *scratch = malloc((largest ? largest : 1)*sizeof(uint64_t));
+    if(!scratch) PERROR("Couldn't allocate space to sort a bucket of %"PRIu64" passages.",largest);
+    for(index_t b = atomic_fetch_add(&k->next_bucket,1) ; b < buckets ; b = atomic_fetch_add(&k->next_bucket,1)){
+        index_t start = b ? ends[b-1] : 0;
+        sort_bucket(&k->sorted[start],ends[b]-start,shift,scratch);
+    }
+    free(scratch);
+}
+
+static void kruskal_accept(_kruskal_t *k, uint8_t id){
+    for(uint64_t round = 0 ; !k->finished ; ++round){
+        index_t *window = k->window[round%2];
+        index_t first = k->window_size*id/k->workers, last = k->window_size*(id+1)/k->workers;
+
+        for(index_t slot = first ; slot < last ; ++slot){
+            index_t from, to;
+            bool south;
+            passage_cells(k,k->sorted[window[slot]],&from,&to,&south);
+            index_t u = kruskal_find(k->parent,from), v = kruskal_find(k->parent,to);
+            k->roots[2*slot] = u;
+            k->roots[2*slot+1] = v;
+            k->pending[slot] = u != v;
+            if(u == v) continue;
+            reserve(k->reserved,u,window[slot]);
+            reserve(k->reserved,v,window[slot]);
+        }
+        pthread_barrier_wait(&k->barrier);
+
+        index_t survivors = 0, accepted = 0;
+        for(index_t slot = first ; slot < last ; ++slot){
+            if(!k->pending[slot]) continue;
+            index_t u = k->roots[2*slot], v = k->roots[2*slot+1], position = window[slot];
+            if(atomic_load_explicit(&k->reserved[v],memory_order_relaxed) == position){
+                // u may stay a root, free it for the next round
+                if(atomic_load_explicit(&k->reserved[u],memory_order_relaxed) == position)
+                    atomic_store_explicit(&k->reserved[u],NO_RESERVATION,memory_order_relaxed);
+                atomic_store_explicit(&k->parent[v],u,memory_order_relaxed);
+            }else if(atomic_load_explicit(&k->reserved[u],memory_order_relaxed) == position){
+                atomic_store_explicit(&k->parent[u],v,memory_order_relaxed);
+            }else{
+                survivors++;
+                continue;
+            }
+            open_passage(k,k->sorted[position]);
+            k->pending[slot] = false;
+            accepted++;
+        }
+        k->survivors[id] = survivors;
+        k->newly_accepted[id] = accepted;
+        pthread_barrier_wait(&k->barrier);
+
+        if(id == 0){
+            index_t offset = 0;
+            for(uint8_t w = 0 ; w < k->workers ; ++w){
+                index_t count = k->survivors[w];
+                k->survivors[w] = offset;
+                offset += count;
+                k->accepted += k->newly_accepted[w];
+            }
+            // survivors first, they come before the passages not seen yet
+            index_t fresh = k->number_of_keys - k->next_key;
+            if(fresh > KRUSKAL_WINDOW - offset) fresh = KRUSKAL_WINDOW - offset;
+            k->survivors_end = offset;
+            k->fresh_start = k->next_key;
+            k->next_key += fresh;
+            k->window_size = offset + fresh;
+            k->finished = k->window_size == 0 ||
+                          k->accepted+1 == (index_t)k->maze.dimensions.x*k->maze.dimensions.y;
+        }
+        pthread_barrier_wait(&k->barrier);
+
+        index_t *next = k->window[(round+1)%2];
+        index_t out = k->survivors[id];
+        for(index_t slot = first ; slot < last ; ++slot)
+            if(k->pending[slot]) next[out++] = window[slot];
+        index_t fresh = k->window_size - k->survivors_end;
+        for(index_t i = fresh*id/k->workers ; i < fresh*(id+1)/k->workers ; ++i)
+            next[k->survivors_end+i] = k->fresh_start + i;
+        pthread_barrier_wait(&k->barrier);
+    }
+}
+
+static void * _kruskal_thread(void *void_args){
+    _kruskal_args_t *args = (_kruskal_args_t*) void_args;
+    _kruskal_t *k = args->kruskal;
+    pin_worker(args->id,k->workers);
+
+    kruskal_make_keys(k,args->id);
+    pthread_barrier_wait(&k->barrier);
+    kruskal_sort(k,args->id);
+    pthread_barrier_wait(&k->barrier);
+    if(args->id == 0){
+        k->window_size = k->number_of_keys < KRUSKAL_WINDOW ? k->number_of_keys : KRUSKAL_WINDOW;
+        for(index_t i = 0 ; i < k->window_size ; ++i)
+            k->window[0][i] = i;
+        k->next_key = k->window_size;
+        k->finished = k->window_size == 0;
+    }
+    pthread_barrier_wait(&k->barrier);
+    kruskal_accept(k,args->id);
+    return NULL;
+}
+
+
+
+maze_t generate_random_maze_kruskal(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed){
+    maze_t maze;
+    alloc_maze_for_workers(&maze,dim_x,dim_y,workers);
+    if(workers == 0) workers = 1;
+    if((index_t)dim_x*dim_y < 2) return maze;
+
+    _kruskal_t k = {0};
+    k.maze = maze;
+    k.seed = seed;
+    k.workers = workers;
+    index_t cells = (index_t)dim_x*dim_y;
+    k.number_of_keys = (index_t)(dim_x-1)*dim_y + (index_t)dim_x*(dim_y-1);
+    // the ids are below 2*cells, the weight keeps the other bits
+    while(((index_t)1 << k.id_bits) < 2*cells) k.id_bits++;
+    k.bucket_bits = 1;
+    while(k.bucket_bits < KRUSKAL_BUCKET_BITS && ((index_t)16 << k.bucket_bits) < k.number_of_keys)
+        k.bucket_bits++;
+
+    k.keys = alloc_cells_for_workers(k.number_of_keys,sizeof(uint64_t),workers);
+    k.sorted = alloc_cells_for_workers(k.number_of_keys,sizeof(uint64_t),workers);
+    k.parent = alloc_cells_for_workers(cells,sizeof(index_t),workers);
+    k.reserved = alloc_cells_for_workers(cells,sizeof(index_t),workers);
+    k.bucket_counts = calloc((index_t)workers << k.bucket_bits,sizeof(index_t));
+    k.window[0] = malloc(KRUSKAL_WINDOW*sizeof(index_t));
+    k.window[1] = malloc(KRUSKAL_WINDOW*sizeof(index_t));
+    k.roots = malloc(2*KRUSKAL_WINDOW*sizeof(index_t));
+    k.pending = malloc(KRUSKAL_WINDOW*sizeof(bool));
+    k.survivors = calloc(workers,sizeof(index_t));
+    k.newly_accepted = calloc(workers,sizeof(index_t));
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _kruskal_args_t *args = calloc(workers,sizeof(_kruskal_args_t));
+    if(!k.keys || !k.sorted || !k.parent || !k.reserved || !k.bucket_counts || !k.window[0] || !k.window[1] ||
+       !k.roots || !k.pending || !k.survivors || !k.newly_accepted || !tid || !args)
+        PERROR("Couldn't allocate space for Kruskal's algorithm on a %ux%u maze.",dim_x,dim_y);
+    atomic_init(&k.next_bucket,0);
+    pthread_barrier_init(&k.barrier,NULL,workers);
+
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_kruskal_args_t){&k,i};
+        pthread_create(&tid[i],NULL,_kruskal_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    pthread_barrier_destroy(&k.barrier);
+    free(k.keys);
+    free(k.sorted);
+    free((void*)k.parent);
+    free((void*)k.reserved);
+    free(k.bucket_counts);
+    free(k.window[0]);
+    free(k.window[1]);
+    free(k.roots);
+    free(k.pending);
+    free(k.survivors);
+    free(k.newly_accepted);
+    free(tid);
+    free(args);
+    return maze;
+}
@@ -1,207 +1,288 @@
 #include "maze.h"
 #include "common.h"
+#include "topology.h"
+#include "random.h"
+#include "path_index.h"
 #include <pthread.h>
-
-static int_t * random_maze_blueprint_MCMC(int_t dim_x, int_t dim_y, uint64_t number_of_iterations){
-#define generator_maze_position(_x,_y) (_x)+dim_x*(_y)
-#define generator_maze_at(_x,_y) generator_maze[generator_maze_position(_x,_y)]
-#define origin_x (origin%dim_x)
-#define origin_y (origin/dim_x )
- 
-    int_t *generator_maze = (int_t*)calloc(sizeof(int_t),(dim_y*dim_x));
-    // everyone points to the right
-    for (int_t y = 0 ; y < dim_y ;++y){
-        for(int_t x = 0 ; x < dim_x-1 ; ++x){
-            generator_maze_at(x,y) = x+dim_x*y + 1;
+#include <stdatomic.h>
+#include <string.h>
+#include <math.h>
+
+// The blueprint keeps, for every cell, the direction of its parent in the
+// tree rooted at the origin, 2 bits per cell (the log2 of the direction:
+// 0 NORTH, 1 EAST, 2 SOUTH, 3 WEST). The bits of the origin are meaningless,
+// the origin is kept apart.
+typedef struct{
+    uint8_t *parents;
+    int_t dim_x, dim_y;
+    index_t origin;
+} mcmc_blueprint_t;
+#define blueprint_parent(bp,_i) (((bp).parents[(_i)>>2] >> (((_i)&3)<<1)) & 3)
+#define set_blueprint_parent(bp,_i,_code) \
+    ((bp).parents[(_i)>>2] = ((bp).parents[(_i)>>2] & ~(3 << (((_i)&3)<<1))) | ((_code) << (((_i)&3)<<1)))
+
+#define CODE_NORTH 0
+#define CODE_EAST 1
+#define CODE_SOUTH 2
+#define CODE_WEST 3
+
+// the origin, with the random bits it hasn't used yet
+typedef struct{
+    int_t x, y;
+    index_t origin;
+    random_t random;
+    uint64_t random_bits;
+    uint8_t bits_left;
+    int64_t step[4];            // index offset of every direction
+} mcmc_walker_t;
+
+// moves the origin to a random neighbour and returns it.
+// The next origin only depends on the random bits and not on where the
+// origin is, so directions leaving the maze are drawn again instead of
+// masking them out first: that keeps the table lookups off the iteration
+// to iteration dependency chain. Redrawing is uniform over the neighbours
+// as well, and only happens on the border
+static inline index_t mcmc_step(mcmc_walker_t *walker, mcmc_blueprint_t bp){
+    static const int dx[4] = {0,1,0,-1};
+    static const int dy[4] = {-1,0,1,0};
+    for(;;){
+        if(walker->bits_left == 0){
+            walker->random_bits = next_random(&walker->random);
+            walker->bits_left = 32;
         }
+        uint8_t code = walker->random_bits & 3;
+        walker->random_bits >>= 2;
+        walker->bits_left--;
+
+        int_t next_x = walker->x + dx[code];
+        int_t next_y = walker->y + dy[code];
+        if(next_x >= bp.dim_x || next_y >= bp.dim_y) continue; // also catches -1
+
+        set_blueprint_parent(bp,walker->origin,code);
+        walker->origin += walker->step[code];
+        walker->x = next_x;
+        walker->y = next_y;
+        return walker->origin;
     }
+}
 
-    // the rightmost column points down
-    for (int_t y = 0 ; y < dim_y -1 ; ++y)
-        generator_maze_at(dim_x-1,y) = generator_maze_position(dim_x-1,y)+dim_x;
+// The walk runs number_of_iterations steps, or less if covered_target isn't
+// 0: then the cells the origin has been on are kept in a bitmap, and the
+// walk stops as soon as covered_target of them have been visited. A cell
+// the origin has left points along the walk, the others still point the
+// way they started, so once every cell has been visited (the cover time)
+// nothing of the starting tree is left. The steps taken go to *used.
+static mcmc_blueprint_t random_maze_blueprint_MCMC(int_t dim_x, int_t dim_y, uint64_t number_of_iterations,
+                                                   index_t covered_target, uint64_t *used, random_t *random){
+    mcmc_blueprint_t bp;
+    bp.dim_x = dim_x;
+    bp.dim_y = dim_y;
+    index_t cells = (index_t)dim_x*dim_y;
+    bp.parents = (uint8_t*) alloc_cells((cells+3)/4,sizeof(uint8_t));
+    if(!bp.parents)
+        PERROR("Couldn't allocate space for the maze blueprint with size: %d x %d",dim_x,dim_y);
+
+    // everyone points to the right, the rightmost column points down
+    memset(bp.parents,(CODE_EAST<<6)|(CODE_EAST<<4)|(CODE_EAST<<2)|CODE_EAST,(cells+3)/4);
+    for(int_t y = 0 ; y < dim_y ; ++y)
+        set_blueprint_parent(bp,(index_t)y*dim_x + dim_x-1,CODE_SOUTH);
 
     // the origin is the lower right of the maze
-    int_t origin =  dim_x*dim_y -1; 
-    // the pointer in the origin points to NULL (-1)
-    generator_maze_at(dim_x-1,dim_y-1) = (int_t)-1;
+    int_t x = dim_x-1, y = dim_y-1;
+    index_t origin = cells-1;
+    if(cells == 1) number_of_iterations = 0;
+
+    uint64_t *visited = NULL;
+    index_t covered = 1;
+    if(covered_target){
+        visited = (uint64_t*) alloc_cells((cells+63)/64,sizeof(uint64_t));
+        if(!visited) PERROR("Couldn't allocate the visited cells of a %d x %d maze",dim_x,dim_y);
+        visited[origin >> 6] |= (uint64_t)1 << (origin & 63);
+        if(covered >= covered_target) number_of_iterations = 0;
+    }
 
     // the algorithm has the following steps:
     /*
         1. the origin points to a random neighbor
         2. the neighbor node becomes the new origin
-        3. the new origin points to NULL (-1)
+        3. the new origin points to NULL
         4. go back to (1) unless you want to finish, anytime
     */
-    for(uint64_t i = 0 ; i < number_of_iterations ; ++i){
-        direction_t available = NORTH|WEST|SOUTH|EAST;
-        direction_t prohibited = 0;
-
-        if(origin_x == 0) 
-            prohibited|=WEST;
-        if(origin_x == dim_x-1) 
-            prohibited|=EAST;
-        if(origin_y == 0)
-            prohibited |=NORTH;
-        if(origin_y == dim_y-1)
-            prohibited |= SOUTH;
-        
-        available&=~prohibited;
-
-        direction_t chosen_direction = random_direction(available);
-
-        switch (chosen_direction){
-            case NORTH :
-
-                generator_maze[origin] = origin - dim_x;
-                origin = generator_maze[origin];
-
-                break; 
-            case WEST  :
-
-                generator_maze[origin] = origin -1;
-                origin = generator_maze[origin];
-
-                break; 
-            case SOUTH : 
-
-                generator_maze[origin] = origin + dim_x;
-                origin = generator_maze[origin];
-
-                break; 
-            case EAST  : 
-
-                generator_maze[origin] = origin +1;
-                origin = generator_maze[origin];
-
-                break;
-            default:
-                break;
-                
+    // a local copy of the generator stays in registers, the blueprint
+    // writes could alias it otherwise
+    mcmc_walker_t walker = {x,y,origin,*random,0,0,{-(int64_t)dim_x,1,dim_x,-1}};
+    uint64_t i = 0;
+    if(!visited){
+        for( ; i < number_of_iterations ; ++i)
+            mcmc_step(&walker,bp);
+    }else{
+        while(i < number_of_iterations){
+            index_t cell = mcmc_step(&walker,bp);
+            ++i;
+            // new cells get rare as the walk goes on, the branch is predicted
+            if(!(visited[cell >> 6] & ((uint64_t)1 << (cell & 63)))){
+                visited[cell >> 6] |= (uint64_t)1 << (cell & 63);
+                if(++covered >= covered_target) break;
+            }
         }
-        
-        generator_maze[origin] = (int_t)-1;
     }
-
-    return generator_maze;
-#undef origin_x
-#undef origin_y
-#undef generator_maze_position
-#undef generator_maze_at
+    origin = walker.origin;
+    *random = walker.random;
+    free(visited);
+    if(used) *used = i;
+    bp.origin = origin;
+    return bp;
 }
 
 
 
-static direction_t get_pointing_direction(maze_t *maze,int_t* blueprint,int_t x, int_t y){
-    int_t dim_x = maze->dimensions.x;
-    int_t dim_y = maze->dimensions.y;
-    if(blueprint[x+y*dim_x] == (int_t)-1) return 0; // origin, points to no one
-    if(x+1 < dim_x && blueprint[x+y*dim_x] == (x+1)+y*dim_x) return EAST;
-    if(x-1 >= 0    && blueprint[x+y*dim_x] == (x-1)+y*dim_x) return WEST;
-    if(y+1 < dim_y && blueprint[x+y*dim_x] == x+(y+1)*dim_x) return SOUTH;
-    if(y-1 >= 0    && blueprint[x+y*dim_x] == x+(y-1)*dim_x) return NORTH;
-    return 0;
+// every cell opens towards its parent and towards the neighbours that
+// point to it. Cells only write themselves, so rows can be built by
+// different workers
+static void build_blueprint_rows(maze_t *maze, mcmc_blueprint_t bp, int_t first_row, int_t last_row){
+    int_t dim_x = bp.dim_x;
+    int_t dim_y = bp.dim_y;
+    for(int_t y = first_row ; y < last_row ; ++y){
+        for(int_t x = 0 ; x < dim_x ; ++x){
+            index_t i = x + (index_t)y*dim_x;
+            direction_t open = 0;
+            if(i != bp.origin) open |= 1 << blueprint_parent(bp,i);
+            if(x > 0       && i-1 != bp.origin     && blueprint_parent(bp,i-1) == CODE_EAST)     open |= WEST;
+            if(x+1 < dim_x && i+1 != bp.origin     && blueprint_parent(bp,i+1) == CODE_WEST)     open |= EAST;
+            if(y > 0       && i-dim_x != bp.origin && blueprint_parent(bp,i-dim_x) == CODE_SOUTH) open |= NORTH;
+            if(y+1 < dim_y && i+dim_x != bp.origin && blueprint_parent(bp,i+dim_x) == CODE_NORTH) open |= SOUTH;
+            maze_at(*maze,x,y).open_directions = open;
+        }
+    }
 }
 
+typedef struct{
+    maze_t *maze;
+    mcmc_blueprint_t bp;
+    int_t first_row, last_row;
+    uint8_t id, workers;
+} _build_maze_blueprint_thread_args_t;
+static void * _build_maze_blueprint_thread(void *void_args){
+    _build_maze_blueprint_thread_args_t *args = (_build_maze_blueprint_thread_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    build_blueprint_rows(args->maze,args->bp,args->first_row,args->last_row);
+    return NULL;
+}
 
-
-static void build_maze_blueprint_MCMC(maze_t *maze,int_t* blueprint){
-    int_t dim_x = maze->dimensions.x;
-    int_t dim_y = maze->dimensions.y;
-    for(int_t y = 0 ; y < dim_y ; ++y){
-        for(int_t x = 0 ; x < dim_x ; ++x){
-            direction_t pointing_towards = get_pointing_direction(maze,blueprint,x,y);
-            switch (pointing_towards){
-                case NORTH:
-                    maze_at(*maze,x,y).open_directions |=NORTH;
-                    maze_at(*maze,x,y-1).open_directions |=SOUTH;
-                break;
-                case SOUTH:
-                    maze_at(*maze,x,y).open_directions |=SOUTH;
-                    maze_at(*maze,x,y+1).open_directions |=NORTH;
-                break;
-                case WEST:
-                    maze_at(*maze,x,y).open_directions |=WEST;
-                    maze_at(*maze,x-1,y).open_directions |=EAST;
-                break;
-                case EAST:
-                    maze_at(*maze,x,y).open_directions |=EAST;
-                    maze_at(*maze,x+1,y).open_directions |=WEST;
-                break;
-                default:
-                break;
-            }
-
+static void build_maze_blueprint_MCMC(maze_t *maze, mcmc_blueprint_t bp, uint8_t workers){
+    if(workers <= 1){
+        build_blueprint_rows(maze,bp,0,bp.dim_y);
+    } else{
+        pthread_t *tid = calloc(workers,sizeof(pthread_t));
+        _build_maze_blueprint_thread_args_t *args = calloc(workers,sizeof(_build_maze_blueprint_thread_args_t));
+        if(!tid || !args) PERROR("Couldn't allocate space for threads while building the maze.");
+        for(uint8_t i = 0 ; i < workers ; ++i){
+            args[i] = (_build_maze_blueprint_thread_args_t){maze,bp,
+                      (uint64_t)bp.dim_y*i/workers,(uint64_t)bp.dim_y*(i+1)/workers,i,workers};
+            pthread_create(&tid[i],NULL,_build_maze_blueprint_thread,(void*)&args[i]);
         }
+        for(uint8_t i = 0 ; i < workers ; ++i)
+            pthread_join(tid[i],NULL);
+        free(tid);
+        free(args);
     }
-    free(blueprint);
 }
 
 
 
-maze_t generate_random_maze_MCMC(int_t dim_x,int_t dim_y,uint64_t number_of_iterations){
+maze_t generate_random_maze_MCMC(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint64_t seed){
+    maze_t maze;
+    alloc_maze(&maze,dim_x,dim_y);
+    random_t random;
+    seed_random(&random,seed);
+    mcmc_blueprint_t blueprint = random_maze_blueprint_MCMC(dim_x,dim_y,number_of_iterations,0,NULL,&random);
+    build_maze_blueprint_MCMC(&maze,blueprint,CPU_CORES);
+    free(blueprint.parents);
+    return maze;
+}
+
+// the blueprint is already the tree of the path index
+maze_t generate_random_maze_MCMC_indexed(int_t dim_x, int_t dim_y, uint64_t number_of_iterations,
+                                         uint64_t seed, path_index_t *index){
+    maze_t maze;
+    alloc_maze(&maze,dim_x,dim_y);
+    random_t random;
+    seed_random(&random,seed);
+    mcmc_blueprint_t blueprint = random_maze_blueprint_MCMC(dim_x,dim_y,number_of_iterations,0,NULL,&random);
+    build_maze_blueprint_MCMC(&maze,blueprint,CPU_CORES);
+    *index = (path_index_t){blueprint.parents,NULL,dim_x,dim_y,blueprint.origin};
+    path_index_depths(index);
+    return maze;
+}
+
+maze_t generate_random_maze_MCMC_adaptive(int_t dim_x,int_t dim_y,double coverage,uint64_t *iterations_used,uint64_t seed){
+    if(coverage <= 0 || coverage > 1) PERROR("Coverage of the MCMC walk must be in (0,1], got %f",coverage);
     maze_t maze;
-    maze.dimensions.x=dim_x;
-    maze.dimensions.y=dim_y; 
     alloc_maze(&maze,dim_x,dim_y);
-    int_t * blueprint =random_maze_blueprint_MCMC(dim_x,dim_y,number_of_iterations);
-    build_maze_blueprint_MCMC(&maze,blueprint);
+    random_t random;
+    seed_random(&random,seed);
+    index_t cells = (index_t)dim_x*dim_y;
+    index_t covered_target = (index_t)ceil(coverage*cells);
+    if(covered_target < 1) covered_target = 1;
+    if(covered_target > cells) covered_target = cells;
+    mcmc_blueprint_t blueprint = random_maze_blueprint_MCMC(dim_x,dim_y,UINT64_MAX,covered_target,iterations_used,&random);
+    build_maze_blueprint_MCMC(&maze,blueprint,CPU_CORES);
+    free(blueprint.parents);
     return maze;
 }
 
 
 
+// The parallel generator splits the maze in a fixed grid of tiles that
+// doesn't depend on the number of workers. Workers take the next tile
+// from a shared counter and seed their generator with the tile number,
+// so the same seed gives the same maze with any number of workers.
+// Each tile is a perfect maze, and they are joined along a random
+// spanning tree of the grid (glue_tiles), so the whole maze is perfect too.
+#define MCMC_TILES_PER_SIDE 8
+
 typedef struct{
     uint64_t number_of_iterations;
-    maze_t sub_maze;
+    index_t number_of_cells;
+    maze_t *tiles;
+    uint32_t number_of_tiles;
+    atomic_uint *next_tile;
+    uint64_t seed;
     uint8_t id;
+    uint8_t workers;
 } _generate_random_maze_MCMC_thread_args_t;
-static pthread_mutex_t mutex;
 static void * _generate_random_maze_MCMC_thread(void*void_args);
-// static void glue_maze(maze_t maze, maze_t* sub_mazes, uint8_t parts);
-static void naive_glue_maze(maze_t maze, maze_t* sub_mazes, uint8_t parts);
-maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers){
-    if(log2l(dim_x) != (int_t)log2l(dim_x) || dim_x != dim_y)
-        PERROR("Parallel maze generation currently only suports square mazes with powers of two for sides");
-    // if only one worker, just use sequential generation
-    if(workers == 1)
-        return generate_random_maze_MCMC(dim_x,dim_y,number_of_iterations);
-    
-    if(log2l(workers) != (int_t)log2l(workers)) 
-        PERROR("Couldn't generate generate random maze in paralel, only power of two worker threads accepted");
-
-    // create and allocate an empty maze, and a array of sub_mazes
+maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers,uint64_t seed){
+    if(workers < 1) workers = 1;
+
+    // create and allocate an empty maze, and a array of tiles
     maze_t maze;
-    alloc_maze(&maze,dim_x,dim_y);
-    if(!maze.data) 
-        PERROR("Couldn't allocate space for maze with size %d x %d",dim_x,dim_y);
-    maze_t *sub_mazes = calloc(workers,sizeof(maze_t));
-    if(!sub_mazes) 
-        PERROR("Couldn't allocate space for submazes while generating maze in parallel. Number of Workers: %d",workers);
-    
-    // split the main maze so that each 
-    // element of the sub_mazes array 
-    // *references* some part of the maze
-    split_maze(maze,sub_mazes,workers);
+    alloc_maze_for_workers(&maze,dim_x,dim_y,workers);
+    int_t longest_side = dim_x > dim_y ? dim_x : dim_y;
+    int_t tile_side = (longest_side + MCMC_TILES_PER_SIDE-1)/MCMC_TILES_PER_SIDE;
+    vec2_t grid;
+    maze_t *tiles = tile_maze(maze,tile_side,&grid);
+    uint32_t number_of_tiles = grid.x*grid.y;
 
 
     // allocate threads
-
-    pthread_mutex_init(&mutex,NULL);
-
+    atomic_uint next_tile;
+    atomic_init(&next_tile,0);
     pthread_t * tid = calloc(workers,sizeof(pthread_t));
-    if(!tid) PERROR("Couldn't allocate space for threads while generating maze in parallel.");
+    _generate_random_maze_MCMC_thread_args_t *args = calloc(workers,sizeof(_generate_random_maze_MCMC_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while generating maze in parallel.");
 
     for(uint8_t i = 0 ; i < workers ; ++i){
-        _generate_random_maze_MCMC_thread_args_t *args;
-        size_t args_size = sizeof(_generate_random_maze_MCMC_thread_args_t);
-        args = malloc(args_size);
-        if(!args) PERROR("Couldn't allocate space for arguments in thread %d while generating maze in parallel.",i);
-        
-        args->number_of_iterations = number_of_iterations;
-        args->sub_maze = sub_mazes[i];
-        args->id = i;
+        args[i].number_of_iterations = number_of_iterations;
+        args[i].number_of_cells = (index_t)dim_x*dim_y;
+        args[i].tiles = tiles;
+        args[i].number_of_tiles = number_of_tiles;
+        args[i].next_tile = &next_tile;
+        args[i].seed = seed;
+        args[i].id = i;
+        args[i].workers = workers;
         
-        pthread_create(&tid[i],NULL,_generate_random_maze_MCMC_thread,(void*)args);
+        pthread_create(&tid[i],NULL,_generate_random_maze_MCMC_thread,(void*)&args[i]);
     }
 
     // join threads
@@ -209,17 +290,13 @@ maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t numbe
         pthread_join(tid[i],(void**)NULL);
     }
 
-
-    // Now that we generated the "insides" of each sub maze, we 
-    // must connect them, to do so, we simply "glue them"
-
-    // glue_maze(maze,sub_mazes,workers);
-    naive_glue_maze(maze,sub_mazes,workers);
+    // the tile streams use keys below number_of_tiles
+    glue_tiles(tiles,grid,keyed_random(seed,number_of_tiles));
 
     // free memory and return maze
-    pthread_mutex_destroy(&mutex);
     free(tid);
-    free(sub_mazes);
+    free(args);
+    free(tiles);
     return maze;
 }
 
@@ -228,194 +305,324 @@ maze_t generate_random_maze_MCMC_parallel(int_t dim_x,int_t dim_y,uint64_t numbe
 static void * _generate_random_maze_MCMC_thread(void*void_args){
     _generate_random_maze_MCMC_thread_args_t *args;
     args = (_generate_random_maze_MCMC_thread_args_t *)void_args;
-
-    int_t dim_x,dim_y;
-    dim_x = args->sub_maze.dimensions.x;
-    dim_y = args->sub_maze.dimensions.y;
-    uint64_t number_of_iterations = args->number_of_iterations;
-
-    // hashing function on thread id and current time for seed generation
-    // we do it with a mutex, to assure time is different on each one
-    pthread_mutex_lock(&mutex);
-    uint8_t seed = (100*args->id)*time(NULL)+time(NULL)%119;
-    srand(seed);
-    pthread_mutex_unlock(&mutex);
-
-    int_t *blueprint = random_maze_blueprint_MCMC(dim_x,dim_y,number_of_iterations);
-    build_maze_blueprint_MCMC(&(args->sub_maze),blueprint);
-    
-    free(args);
+    pin_worker(args->id,args->workers);
+
+    for(uint32_t tile = atomic_fetch_add(args->next_tile,1) ; tile < args->number_of_tiles ; 
+        tile = atomic_fetch_add(args->next_tile,1)){
+        maze_t sub_maze = args->tiles[tile];
+
+        // every tile has its own generator, keyed by the tile, and its
+        // share of the iterations
+        random_t random;
+        seed_random_stream(&random,args->seed,tile);
+        index_t cells = (index_t)sub_maze.dimensions.x*sub_maze.dimensions.y;
+        uint64_t iterations = (uint64_t)((long double)args->number_of_iterations*cells/args->number_of_cells);
+
+        mcmc_blueprint_t blueprint = random_maze_blueprint_MCMC(sub_maze.dimensions.x,sub_maze.dimensions.y,
+                                                                iterations,0,NULL,&random);
+        build_maze_blueprint_MCMC(&sub_maze,blueprint,1);
+        free(blueprint.parents);
+    }
 
     return (void*)NULL;
 }
 
 
 
-static void randomly_connect_sub_mazes_horizontal(maze_t left,maze_t right){
-    if(left.dimensions.y != right.dimensions.y) 
-        PERROR("Invalid maze connection. Should have same height.");
-
-    uint8_t number = rand()%left.dimensions.y;
-    maze_at(left,left.dimensions.x-1,number).open_directions |= EAST;
-    maze_at(right,0,number).open_directions |= WEST;
-}
+// The multi-walker generator runs one origin per tile of the same fixed
+// grid, all of them on one blueprint of the whole maze, so there are no
+// seams to glue. Every cell keeps the direction of its parent, a byte per
+// cell so that tiles never share one, and the cells under an origin are
+// roots: moving an origin points its cell to the next one and makes that
+// one a root, which keeps the blueprint a forest whoever moves.
+//
+// The walk goes in epochs. In every epoch the origins of half of the
+// tiles, a checkerboard, walk without leaving their tile, so walkers of
+// different tiles never touch the same cells. The checkerboard flips every
+// epoch and the grid moves by a random offset, so the origins cross the
+// tile borders and no wall stays on a border for long. At the end the trees of the forest are linked
+// along a random spanning tree of the trees, one passage between each pair
+// of joined trees, which leaves a single tree of the whole maze.
+#define MULTIWALKER_EPOCHS 32
+#define CODE_ROOT 4
+#define NO_TILE UINT32_MAX
+#define NO_LABEL UINT8_MAX
 
+typedef struct{
+    uint8_t *parents;
+    int_t dim_x, dim_y, tile_side;
+    vec2_t *walkers;
+    uint32_t number_of_walkers;
+    uint32_t *walker_tile;      // tile of every walker in this epoch, NO_TILE if it rests
+    uint64_t steps;             // of a walker in an epoch its tile is active
+    uint64_t seed;
+    maze_t maze;
+    atomic_uint next_tile[MULTIWALKER_EPOCHS];
+    pthread_barrier_t barrier;
+    uint8_t workers;
+} _multiwalker_t;
 
-
-static void randomly_connect_sub_mazes_vertical(maze_t up,maze_t down){
-    if(up.dimensions.x != down.dimensions.x)
-        PERROR("Invalid maze connection. Should have same width.");
-
-    uint8_t number = rand()%up.dimensions.x;
-    maze_at(up,number,up.dimensions.y-1).open_directions |= SOUTH;
-    maze_at(down,number,0).open_directions |= NORTH;
+typedef struct{
+    _multiwalker_t *mw;
+    uint8_t id;
+} _multiwalker_thread_args_t;
+
+// the tile grid of an epoch is moved up and left by a random offset, so
+// that the walls on a tile border change from epoch to epoch
+static inline vec2_t epoch_offset(_multiwalker_t *mw, uint32_t epoch){
+    if(epoch == 0) return (vec2_t){0,0};
+    uint64_t random = keyed_random(mw->seed,MULTIWALKER_EPOCHS + epoch);
+    return (vec2_t){((random & UINT32_MAX)*mw->tile_side) >> 32,((random >> 32)*mw->tile_side) >> 32};
+}
+static inline vec2_t epoch_grid(_multiwalker_t *mw, vec2_t offset){
+    return (vec2_t){(mw->dim_x + offset.x + mw->tile_side-1)/mw->tile_side,
+                    (mw->dim_y + offset.y + mw->tile_side-1)/mw->tile_side};
+}
+static inline bool tile_is_active(uint32_t tile_x, uint32_t tile_y, uint32_t epoch){
+    return ((tile_x + tile_y) & 1) == (epoch & 1);
 }
 
+// walks one origin inside [x0,x1) x [y0,y1), moves that would leave it are
+// drawn again
+static void multiwalker_walk(_multiwalker_t *mw, uint32_t walker, uint32_t epoch,
+                             int_t x0, int_t y0, int_t x1, int_t y1){
+    int_t width = x1 - x0, height = y1 - y0;
+    if((index_t)width*height <= 1) return;
+    static const int dx[4] = {0,1,0,-1};
+    static const int dy[4] = {-1,0,1,0};
+    const int64_t step[4] = {-(int64_t)mw->dim_x, 1, mw->dim_x, -1};
+    uint8_t *parents = mw->parents;
+    random_t random;
+    seed_random_stream(&random,keyed_random(mw->seed,epoch),walker);
+    int_t x = mw->walkers[walker].x, y = mw->walkers[walker].y;
+    index_t origin = x + (index_t)y*mw->dim_x;
+    uint64_t random_bits = 0;
+    uint8_t bits_left = 0;
+    for(uint64_t i = 0 ; i < mw->steps ; ){
+        if(bits_left == 0){
+            random_bits = next_random(&random);
+            bits_left = 32;
+        }
+        uint8_t code = random_bits & 3;
+        random_bits >>= 2;
+        bits_left--;
+
+        int_t next_x = x + dx[code];
+        int_t next_y = y + dy[code];
+        if(next_x - x0 >= width || next_y - y0 >= height) continue; // also catches x0-1 and y0-1
+
+        parents[origin] = code;
+        origin += step[code];
+        parents[origin] = CODE_ROOT;
+        x = next_x;
+        y = next_y;
+        ++i;
+    }
+    mw->walkers[walker] = (vec2_t){x,y};
+}
 
+typedef struct{
+    uint64_t key;
+    index_t cell;               // the passage goes east or south of it
+    uint8_t code;
+    uint8_t first, second;      // the trees it joins
+} _multiwalker_link_t;
+
+static int compare_links(const void *a, const void *b){
+    uint64_t key_a = ((const _multiwalker_link_t*)a)->key, key_b = ((const _multiwalker_link_t*)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
 
-static void naive_glue_maze(maze_t maze, maze_t* sub_mazes, uint8_t parts){
-#define sub_maze_at(_x,_y) sub_mazes[(_x) + (_y)*cols]
-    uint8_t cols = maze.dimensions.x/sub_mazes[0].dimensions.x;
-    uint8_t rows = maze.dimensions.y/sub_mazes[0].dimensions.y;   
-    srand(time(NULL));
-    maze_t left,right,up,down;
-    for(int y = 0 ; y < rows ; ++y){
-        for(int x = 0 ; x < cols ; ++x){
-        
-            
-            // top left
-            if(x==0 && y==0){
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
-
-            // top right
-            else if(x==cols-1 && y==0){
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
-
-            // bottom left
-            else if(x==0 && y==rows-1){
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
+static uint8_t find_tree(uint8_t *parent, uint8_t tree){
+    while(parent[tree] != tree)
+        tree = parent[tree] = parent[parent[tree]];
+    return tree;
+}
 
-            // bottom right
-            else if(x==cols-1 && y==rows-1){
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
+// hangs the tree of cell under the neighbour in direction code: the path
+// from cell to its root is turned around first, so cell becomes the root
+static void link_tree(uint8_t *parents, const int64_t *step, index_t cell, uint8_t code){
+    for(;;){
+        uint8_t old = parents[cell];
+        parents[cell] = code;
+        if(old == CODE_ROOT) return;
+        cell += step[old];
+        code = old ^ 2;         // the opposite direction
+    }
+}
 
-            // left
-            else if(x==0){
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
+// joins the forest into one tree. There are at most a root per walker and
+// the starting one, so the trees are numbered in a byte
+static void multiwalker_merge(_multiwalker_t *mw){
+    int_t dim_x = mw->dim_x, dim_y = mw->dim_y;
+    index_t cells = (index_t)dim_x*dim_y;
+    uint8_t *parents = mw->parents;
+    const int64_t step[4] = {-(int64_t)dim_x, 1, dim_x, -1};
+    uint8_t *label = (uint8_t*) alloc_cells(cells,sizeof(uint8_t));
+    if(!label) PERROR("Couldn't allocate the tree labels of a %d x %d maze",dim_x,dim_y);
+    memset(label,NO_LABEL,cells);
+
+    // every path to a root is followed once, up to the first labelled cell
+    uint32_t trees = 0;
+    for(index_t cell = 0 ; cell < cells ; ++cell){
+        if(label[cell] != NO_LABEL) continue;
+        index_t root = cell;
+        while(label[root] == NO_LABEL && parents[root] != CODE_ROOT)
+            root += step[parents[root]];
+        if(label[root] == NO_LABEL) label[root] = trees++;
+        for(index_t i = cell ; label[i] == NO_LABEL ; i += step[parents[i]])
+            label[i] = label[root];
+    }
 
-            // top
-            else if(y==0){
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
+    // the passage with the smallest key between every two touching trees
+    _multiwalker_link_t *best = (_multiwalker_link_t*) calloc((size_t)trees*trees,sizeof(_multiwalker_link_t));
+    if(!best) PERROR("Couldn't allocate the links between %u trees",trees);
+    for(index_t i = 0 ; i < (index_t)trees*trees ; ++i)
+        best[i].key = UINT64_MAX;
+    uint64_t link_seed = keyed_random(mw->seed,MULTIWALKER_EPOCHS);
+    for(int_t y = 0 ; y < dim_y ; ++y){
+        for(int_t x = 0 ; x < dim_x ; ++x){
+            index_t cell = x + (index_t)y*dim_x;
+            for(uint8_t code = CODE_EAST ; code <= CODE_SOUTH ; ++code){
+                if(code == CODE_EAST ? x+1 == dim_x : y+1 == dim_y) continue;
+                uint8_t first = label[cell], second = label[cell + step[code]];
+                if(first == second) continue;
+                uint64_t key = keyed_random(link_seed,2*cell + (code == CODE_SOUTH));
+                _multiwalker_link_t *link = &best[first < second ? first*trees + second : second*trees + first];
+                if(key < link->key) *link = (_multiwalker_link_t){key,cell,code,first,second};
             }
+        }
+    }
+    free(label);
+
+    // Kruskal over the trees
+    uint32_t number_of_links = 0;
+    for(index_t i = 0 ; i < (index_t)trees*trees ; ++i)
+        if(best[i].key != UINT64_MAX) best[number_of_links++] = best[i];
+    qsort(best,number_of_links,sizeof(_multiwalker_link_t),compare_links);
+    uint8_t tree_parent[NO_LABEL];
+    for(uint32_t tree = 0 ; tree < trees ; ++tree)
+        tree_parent[tree] = tree;
+    for(uint32_t i = 0 ; i < number_of_links ; ++i){
+        uint8_t first = find_tree(tree_parent,best[i].first), second = find_tree(tree_parent,best[i].second);
+        if(first == second) continue;
+        tree_parent[first] = second;
+        link_tree(parents,step,best[i].cell,best[i].code);
+    }
+    free(best);
+}
 
-            // right
-            else if(x==cols-1){
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
+static void * _multiwalker_thread(void *void_args){
+    _multiwalker_thread_args_t *args = (_multiwalker_thread_args_t*) void_args;
+    _multiwalker_t *mw = args->mw;
+    pin_worker(args->id,mw->workers);
+
+    for(uint32_t epoch = 0 ; epoch < MULTIWALKER_EPOCHS ; ++epoch){
+        vec2_t offset = epoch_offset(mw,epoch);
+        vec2_t grid = epoch_grid(mw,offset);
+        if(args->id == 0){
+            for(uint32_t walker = 0 ; walker < mw->number_of_walkers ; ++walker){
+                uint32_t tile_x = (mw->walkers[walker].x + offset.x)/mw->tile_side;
+                uint32_t tile_y = (mw->walkers[walker].y + offset.y)/mw->tile_side;
+                mw->walker_tile[walker] = tile_is_active(tile_x,tile_y,epoch) ? tile_x + tile_y*grid.x : NO_TILE;
             }
+        }
+        pthread_barrier_wait(&mw->barrier);
+
+        // the walkers of a tile go one after the other, in order
+        for(uint32_t tile = atomic_fetch_add(&mw->next_tile[epoch],1) ; tile < grid.x*grid.y ;
+            tile = atomic_fetch_add(&mw->next_tile[epoch],1)){
+            uint32_t tile_x = tile % grid.x, tile_y = tile / grid.x;
+            if(!tile_is_active(tile_x,tile_y,epoch)) continue;
+            int_t x0 = tile_x*mw->tile_side > offset.x ? tile_x*mw->tile_side - offset.x : 0;
+            int_t y0 = tile_y*mw->tile_side > offset.y ? tile_y*mw->tile_side - offset.y : 0;
+            int_t x1 = (tile_x+1)*mw->tile_side - offset.x, y1 = (tile_y+1)*mw->tile_side - offset.y;
+            if(x1 > mw->dim_x) x1 = mw->dim_x;
+            if(y1 > mw->dim_y) y1 = mw->dim_y;
+            for(uint32_t walker = 0 ; walker < mw->number_of_walkers ; ++walker)
+                if(mw->walker_tile[walker] == tile)
+                    multiwalker_walk(mw,walker,epoch,x0,y0,x1,y1);
+        }
+        pthread_barrier_wait(&mw->barrier);
+    }
 
-            // bottom
-            else if(y==rows-1){
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
-            }
-            
-            // middle
-            else{
-                left = sub_maze_at(x-1,y);
-                right = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                left = sub_maze_at(x,y);
-                right = sub_maze_at(x+1,y);
-                randomly_connect_sub_mazes_horizontal(left,right);
-                up = sub_maze_at(x,y-1);
-                down = sub_maze_at(x,y);
-                randomly_connect_sub_mazes_vertical(up,down);
-                up = sub_maze_at(x,y);
-                down = sub_maze_at(x,y+1);
-                randomly_connect_sub_mazes_vertical(up,down);
+    if(args->id == 0) multiwalker_merge(mw);
+    pthread_barrier_wait(&mw->barrier);
 
-            }
+    // every cell opens towards its parent and the neighbours pointing to it
+    int_t dim_x = mw->dim_x, dim_y = mw->dim_y;
+    int_t first_row = (uint64_t)dim_y*args->id/mw->workers, last_row = (uint64_t)dim_y*(args->id+1)/mw->workers;
+    const uint8_t *parents = mw->parents;
+    for(int_t y = first_row ; y < last_row ; ++y){
+        for(int_t x = 0 ; x < dim_x ; ++x){
+            index_t i = x + (index_t)y*dim_x;
+            direction_t open = parents[i] == CODE_ROOT ? 0 : 1 << parents[i];
+            if(x > 0       && parents[i-1] == CODE_EAST)      open |= WEST;
+            if(x+1 < dim_x && parents[i+1] == CODE_WEST)      open |= EAST;
+            if(y > 0       && parents[i-dim_x] == CODE_SOUTH) open |= NORTH;
+            if(y+1 < dim_y && parents[i+dim_x] == CODE_NORTH) open |= SOUTH;
+            maze_at(mw->maze,x,y).open_directions = open;
         }
     }
-
-#undef sub_maze_at
+    return NULL;
 }
 
-// The gluing part is singlehandedly stopping the algorithm from
-// working for any sized mazes, so If anyone can think of a better way
-// feel free to change it. 
-// static void glue_maze(maze_t maze, maze_t* sub_mazes, uint8_t parts){
-// #define sub_maze_at(_x,_y) sub_mazes[_x + _y*cols]
-//     uint8_t cols = sub_mazes->dimensions.x/maze.dimensions.x;
-//     uint8_t rows = sub_mazes->dimensions.y/maze.dimensions.y;
-//     srand(time(NULL));
-
-//     uint8_t curr_x,curr_y;
-//     curr_x = rand()%cols;
-//     curr_y = rand()%rows;
-//     do{
-//         if(curr_x == 0) continue; // cant go to the left
-//         if(curr_y == 0) continue; // cant go up
-//         if(curr_x == cols-1) continue; // cant go right
-//         if(curr_y == rows-1) continue; // cant go down
-
-//     }while(1);
-
-// #undef sub_maze_at
-// }
+maze_t generate_random_maze_MCMC_multiwalker(int_t dim_x,int_t dim_y,uint64_t number_of_iterations,uint8_t workers,uint64_t seed){
+    if(workers < 1) workers = 1;
+    _multiwalker_t mw;
+    mw.dim_x = dim_x;
+    mw.dim_y = dim_y;
+    mw.seed = seed;
+    mw.workers = workers;
+    alloc_maze_for_workers(&mw.maze,dim_x,dim_y,workers);
+    int_t longest_side = dim_x > dim_y ? dim_x : dim_y;
+    mw.tile_side = (longest_side + MCMC_TILES_PER_SIDE-1)/MCMC_TILES_PER_SIDE;
+    if(mw.tile_side < 2) mw.tile_side = 2;
+
+    // the same starting tree as the single origin, everyone points to the
+    // right and the rightmost column points down, cut by a root under every
+    // walker, which start at the centers of their tiles
+    index_t cells = (index_t)dim_x*dim_y;
+    mw.parents = (uint8_t*) alloc_cells(cells,sizeof(uint8_t));
+    if(!mw.parents) PERROR("Couldn't allocate space for the maze blueprint with size: %d x %d",dim_x,dim_y);
+    memset(mw.parents,CODE_EAST,cells);
+    for(int_t y = 0 ; y < dim_y ; ++y)
+        mw.parents[(index_t)y*dim_x + dim_x-1] = CODE_SOUTH;
+    mw.parents[cells-1] = CODE_ROOT;
+
+    vec2_t grid = epoch_grid(&mw,epoch_offset(&mw,0));
+    mw.number_of_walkers = grid.x*grid.y;
+    mw.walkers = (vec2_t*) calloc(mw.number_of_walkers,sizeof(vec2_t));
+    mw.walker_tile = (uint32_t*) calloc(mw.number_of_walkers,sizeof(uint32_t));
+    if(!mw.walkers || !mw.walker_tile) PERROR("Couldn't allocate %u walkers",mw.number_of_walkers);
+    for(uint32_t walker = 0 ; walker < mw.number_of_walkers ; ++walker){
+        int_t x0 = (walker % grid.x)*mw.tile_side, y0 = (walker / grid.x)*mw.tile_side;
+        int_t x1 = x0 + mw.tile_side < dim_x ? x0 + mw.tile_side : dim_x;
+        int_t y1 = y0 + mw.tile_side < dim_y ? y0 + mw.tile_side : dim_y;
+        mw.walkers[walker] = (vec2_t){(x0+x1)/2,(y0+y1)/2};
+        mw.parents[(x0+x1)/2 + (index_t)((y0+y1)/2)*dim_x] = CODE_ROOT;
+    }
+    // a walker is active about every other epoch
+    mw.steps = 2*number_of_iterations/((uint64_t)mw.number_of_walkers*MULTIWALKER_EPOCHS);
+
+    for(uint32_t epoch = 0 ; epoch < MULTIWALKER_EPOCHS ; ++epoch)
+        atomic_init(&mw.next_tile[epoch],0);
+    pthread_barrier_init(&mw.barrier,NULL,workers);
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _multiwalker_thread_args_t *args = calloc(workers,sizeof(_multiwalker_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while generating maze in parallel.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_multiwalker_thread_args_t){&mw,i};
+        pthread_create(&tid[i],NULL,_multiwalker_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    pthread_barrier_destroy(&mw.barrier);
+    free(tid);
+    free(args);
+    free(mw.walkers);
+    free(mw.walker_tile);
+    free(mw.parents);
+    return mw.maze;
+}
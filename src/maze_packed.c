@@ -0,0 +1,202 @@
+#include "maze_packed.h"
+#include "common.h"
+#include "topology.h"
+#include <pthread.h>
+#include <string.h>
+
+
+
+packed_maze_t alloc_packed_maze(int_t dim_x, int_t dim_y){
+    packed_maze_t maze;
+    maze.dimensions = (vec2_t){dim_x,dim_y};
+    maze.row_bytes = ((size_t)dim_x+3)/4;
+    maze.data = (uint8_t*) calloc(maze.row_bytes*dim_y,1);
+    if(!maze.data)
+        PERROR("Couldn\'t allocate space for the packed maze with size: %d x %d",dim_x,dim_y);
+    return maze;
+}
+
+void free_packed_maze(packed_maze_t *maze){
+    free(maze->data);
+    maze->data = NULL;
+}
+
+
+
+bitplane_maze_t alloc_bitplane_maze(int_t dim_x, int_t dim_y){
+    bitplane_maze_t maze;
+    maze.dimensions = (vec2_t){dim_x,dim_y};
+    maze.row_words = ((size_t)dim_x+63)/64;
+    for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane){
+        maze.planes[plane] = (uint64_t*) calloc(maze.row_words*dim_y,sizeof(uint64_t));
+        if(!maze.planes[plane])
+            PERROR("Couldn\'t allocate space for the bitplane maze with size: %d x %d",dim_x,dim_y);
+    }
+    return maze;
+}
+
+void free_bitplane_maze(bitplane_maze_t *maze){
+    for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane){
+        free(maze->planes[plane]);
+        maze->planes[plane] = NULL;
+    }
+}
+
+
+
+// every conversion writes whole rows, so bands of rows can be converted
+// by different workers without sharing bytes or words
+typedef struct {
+    maze_t maze;
+    packed_maze_t packed;
+    bitplane_maze_t bitplanes;
+    int_t first_row, last_row;
+    uint8_t worker_id, workers;
+} _conversion_args_t;
+
+static void run_in_bands(void *(*convert)(void*), _conversion_args_t shared, int_t rows, uint8_t workers){
+    if(workers < 1) workers = 1;
+    pthread_t *tid = (pthread_t*) calloc(workers,sizeof(pthread_t));
+    _conversion_args_t *args = (_conversion_args_t*) calloc(workers,sizeof(_conversion_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate workers for the maze conversion");
+
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = shared;
+        args[i].first_row = (uint64_t)rows*i/workers;
+        args[i].last_row = (uint64_t)rows*(i+1)/workers;
+        args[i].worker_id = i;
+        args[i].workers = workers;
+        pthread_create(&tid[i],NULL,convert,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+    free(tid);
+    free(args);
+}
+
+
+
+static void * _maze_to_packed_thread(void *void_args){
+    _conversion_args_t *args = (_conversion_args_t*) void_args;
+    pin_worker(args->worker_id,args->workers);
+    int_t dim_x = args->maze.dimensions.x;
+    for(int_t y = args->first_row ; y < args->last_row ; ++y){
+        maze_vertex_t *row = &maze_at(args->maze,0,y);
+        uint8_t *packed = args->packed.data + (size_t)y*args->packed.row_bytes;
+        for(int_t x = 0 ; x < dim_x ; x += 4){
+            uint8_t byte = 0;
+            for(int_t i = 0 ; i < 4 && x+i < dim_x ; ++i){
+                direction_t open = row[x+i].open_directions;
+                byte |= (((open & EAST) ? PACKED_EAST : 0) | ((open & SOUTH) ? PACKED_SOUTH : 0)) << (i<<1);
+            }
+            packed[x>>2] = byte;
+        }
+    }
+    return NULL;
+}
+
+packed_maze_t maze_to_packed(maze_t maze, uint8_t workers){
+    _conversion_args_t shared;
+    shared.maze = maze;
+    shared.packed = alloc_packed_maze(maze.dimensions.x,maze.dimensions.y);
+    run_in_bands(_maze_to_packed_thread,shared,maze.dimensions.y,workers);
+    return shared.packed;
+}
+
+
+
+static void * _packed_to_maze_thread(void *void_args){
+    _conversion_args_t *args = (_conversion_args_t*) void_args;
+    pin_worker(args->worker_id,args->workers);
+    packed_maze_t packed = args->packed;
+    int_t dim_x = packed.dimensions.x;
+    for(int_t y = args->first_row ; y < args->last_row ; ++y){
+        maze_vertex_t *row = &maze_at(args->maze,0,y);
+        uint8_t west_open = 0;
+        for(int_t x = 0 ; x < dim_x ; ++x){
+            uint8_t bits = packed_maze_bits(packed,x,y);
+            direction_t open = west_open ? WEST : 0;
+            if(bits & PACKED_EAST) open |= EAST;
+            if(bits & PACKED_SOUTH) open |= SOUTH;
+            if(y > 0 && (packed_maze_bits(packed,x,y-1) & PACKED_SOUTH)) open |= NORTH;
+            row[x].open_directions = open;
+            west_open = bits & PACKED_EAST;
+        }
+    }
+    return NULL;
+}
+
+maze_t packed_to_maze(packed_maze_t packed, uint8_t workers){
+    _conversion_args_t shared;
+    shared.packed = packed;
+    alloc_maze_for_workers(&shared.maze,packed.dimensions.x,packed.dimensions.y,workers);
+    run_in_bands(_packed_to_maze_thread,shared,packed.dimensions.y,workers);
+    return shared.maze;
+}
+
+
+
+static void * _maze_to_bitplanes_thread(void *void_args){
+    _conversion_args_t *args = (_conversion_args_t*) void_args;
+    pin_worker(args->worker_id,args->workers);
+    bitplane_maze_t bitplanes = args->bitplanes;
+    int_t dim_x = bitplanes.dimensions.x;
+    for(int_t y = args->first_row ; y < args->last_row ; ++y){
+        maze_vertex_t *row = &maze_at(args->maze,0,y);
+        for(size_t w = 0 ; w < bitplanes.row_words ; ++w){
+            uint64_t words[NUMBER_OF_PLANES] = {0,0,0,0};
+            int_t first = w*64;
+            int_t count = dim_x - first < 64 ? dim_x - first : 64;
+            for(int_t i = 0 ; i < count ; ++i){
+                direction_t open = row[first+i].open_directions;
+                for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane)
+                    words[plane] |= (uint64_t)((open >> plane) & 1) << i;
+            }
+            for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane)
+                bitplane_word(bitplanes,plane,y,w) = words[plane];
+        }
+    }
+    return NULL;
+}
+
+bitplane_maze_t maze_to_bitplanes(maze_t maze, uint8_t workers){
+    _conversion_args_t shared;
+    shared.maze = maze;
+    shared.bitplanes = alloc_bitplane_maze(maze.dimensions.x,maze.dimensions.y);
+    run_in_bands(_maze_to_bitplanes_thread,shared,maze.dimensions.y,workers);
+    return shared.bitplanes;
+}
+
+
+
+static void * _bitplanes_to_maze_thread(void *void_args){
+    _conversion_args_t *args = (_conversion_args_t*) void_args;
+    pin_worker(args->worker_id,args->workers);
+    bitplane_maze_t bitplanes = args->bitplanes;
+    int_t dim_x = bitplanes.dimensions.x;
+    for(int_t y = args->first_row ; y < args->last_row ; ++y){
+        maze_vertex_t *row = &maze_at(args->maze,0,y);
+        for(size_t w = 0 ; w < bitplanes.row_words ; ++w){
+            uint64_t words[NUMBER_OF_PLANES];
+            for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane)
+                words[plane] = bitplane_word(bitplanes,plane,y,w);
+            int_t first = w*64;
+            int_t count = dim_x - first < 64 ? dim_x - first : 64;
+            for(int_t i = 0 ; i < count ; ++i){
+                direction_t open = 0;
+                for(int plane = 0 ; plane < NUMBER_OF_PLANES ; ++plane)
+                    open |= ((words[plane] >> i) & 1) << plane;
+                row[first+i].open_directions = open;
+            }
+        }
+    }
+    return NULL;
+}
+
+maze_t bitplanes_to_maze(bitplane_maze_t bitplanes, uint8_t workers){
+    _conversion_args_t shared;
+    shared.bitplanes = bitplanes;
+    alloc_maze_for_workers(&shared.maze,bitplanes.dimensions.x,bitplanes.dimensions.y,workers);
+    run_in_bands(_bitplanes_to_maze_thread,shared,bitplanes.dimensions.y,workers);
+    return shared.maze;
+}
@@ -0,0 +1,149 @@
+#include "maze.h"
+#include "common.h"
+#include "topology.h"
+#include "random.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Wilson's algorithm: from every cell not yet in the maze, walk randomly
+// until the maze is hit, then add the walk with its loops erased. Every
+// spanning tree (perfect maze) of the grid is equally likely.
+//
+// While walking, the upper nibble of a cell keeps the direction the walk
+// last left it by. Walking over a loop just overwrites those directions,
+// so following them from the start of the walk is the loop erased walk.
+
+#define WALK_SHIFT 4
+#define opposite(dir) (((dir)<<2 | (dir)>>2) & 0xF)
+
+// the part of a parallel maze filled by one worker at a time
+#define WILSON_TILE_SIDE 256
+
+
+
+// a random direction that doesn't leave the maze. Directions are drawn
+// 2 bits at a time and the ones leaving the maze are drawn again, which is
+// uniform over the neighbours
+static inline direction_t random_step(random_t *random, uint64_t *bits, uint8_t *bits_left,
+                                      int_t x, int_t y, vec2_t dimensions){
+    while(true){
+        if(*bits_left == 0){
+            *bits = next_random(random);
+            *bits_left = 32;
+        }
+        direction_t direction = 1 << (*bits & 3);
+        *bits >>= 2;
+        (*bits_left)--;
+        if((direction == NORTH && y == 0) || (direction == WEST && x == 0) ||
+           (direction == EAST && x+1 == dimensions.x) || (direction == SOUTH && y+1 == dimensions.y))
+            continue;
+        return direction;
+    }
+}
+
+static inline vec2_t step(vec2_t position, direction_t direction){
+    position.x += (direction == EAST) - (direction == WEST);
+    position.y += (direction == SOUTH) - (direction == NORTH);
+    return position;
+}
+
+
+
+// fills a maze (or a sub-maze) with a uniform spanning tree
+static void wilson_fill(maze_t maze, random_t *random){
+    vec2_t dimensions = maze.dimensions;
+    if((index_t)dimensions.x*dimensions.y < 2) return;
+    vec2_t root = {random_below(random,dimensions.x),random_below(random,dimensions.y)};
+#define in_tree(_p) ((maze_at(maze,(_p).x,(_p).y).open_directions & 0xF) || ((_p).x == root.x && (_p).y == root.y))
+
+    uint64_t bits = 0;
+    uint8_t bits_left = 0;
+    for(int_t y = 0 ; y < dimensions.y ; ++y){
+        for(int_t x = 0 ; x < dimensions.x ; ++x){
+            vec2_t start = {x,y};
+            if(in_tree(start)) continue;
+
+            // random walk until the maze is hit
+            for(vec2_t current = start ; !in_tree(current) ; ){
+                direction_t direction = random_step(random,&bits,&bits_left,current.x,current.y,dimensions);
+                maze_at(maze,current.x,current.y).open_directions = direction << WALK_SHIFT;
+                current = step(current,direction);
+            }
+
+            // add the loop erased walk, clearing the walk directions
+            for(vec2_t current = start ; ; ){
+                maze_vertex_t *cell = &maze_at(maze,current.x,current.y);
+                direction_t direction = cell->open_directions >> WALK_SHIFT;
+                cell->open_directions = (cell->open_directions & 0xF) | direction;
+                vec2_t next = step(current,direction);
+                bool reached_tree = in_tree(next);
+                maze_at(maze,next.x,next.y).open_directions |= opposite(direction);
+                if(reached_tree) break;
+                current = next;
+            }
+        }
+    }
+#undef in_tree
+}
+
+
+
+maze_t generate_random_maze_wilson(int_t dim_x, int_t dim_y, uint64_t seed){
+    maze_t maze;
+    alloc_maze(&maze,dim_x,dim_y);
+    random_t random;
+    seed_random(&random,seed);
+    wilson_fill(maze,&random);
+    return maze;
+}
+
+
+
+typedef struct{
+    maze_t *tiles;
+    uint32_t number_of_tiles;
+    atomic_uint *next_tile;
+    uint64_t seed;
+    uint8_t id, workers;
+} _wilson_thread_args_t;
+static void * _wilson_thread(void *void_args){
+    _wilson_thread_args_t *args = (_wilson_thread_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    for(uint32_t tile = atomic_fetch_add(args->next_tile,1) ; tile < args->number_of_tiles ;
+        tile = atomic_fetch_add(args->next_tile,1)){
+        random_t random;
+        seed_random_stream(&random,args->seed,tile);
+        wilson_fill(args->tiles[tile],&random);
+    }
+    return NULL;
+}
+
+maze_t generate_random_maze_wilson_parallel(int_t dim_x, int_t dim_y, uint8_t workers, uint64_t seed){
+    if(workers < 1) workers = 1;
+    maze_t maze;
+    alloc_maze_for_workers(&maze,dim_x,dim_y,workers);
+
+    vec2_t grid;
+    maze_t *tiles = tile_maze(maze,WILSON_TILE_SIDE,&grid);
+    uint32_t number_of_tiles = grid.x*grid.y;
+
+    atomic_uint next_tile;
+    atomic_init(&next_tile,0);
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _wilson_thread_args_t *args = calloc(workers,sizeof(_wilson_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while generating maze in parallel.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_wilson_thread_args_t){tiles,number_of_tiles,&next_tile,seed,i,workers};
+        pthread_create(&tid[i],NULL,_wilson_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    // the tile streams use keys below number_of_tiles
+    glue_tiles(tiles,grid,keyed_random(seed,number_of_tiles));
+
+    free(tid);
+    free(args);
+    free(tiles);
+    return maze;
+}
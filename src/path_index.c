@@ -0,0 +1,345 @@
+#include "path_index.h"
+#include "common.h"
+#include "topology.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define NO_DEPTH UINT32_MAX
+
+void alloc_path_index(path_index_t *index, int_t dim_x, int_t dim_y){
+    index_t cells = (index_t)dim_x*dim_y;
+    if(cells > NO_DEPTH) PERROR("Can't index the paths of a %u x %u maze, depths are 32 bits",dim_x,dim_y);
+    index->dim_x = dim_x;
+    index->dim_y = dim_y;
+    index->root = 0;
+    index->depth = NULL;
+    index->parents = (uint8_t*) alloc_cells((cells+3)/4,sizeof(uint8_t));
+    if(!index->parents) PERROR("Couldn't allocate the path index of a %u x %u maze",dim_x,dim_y);
+}
+
+void free_path_index(path_index_t *index){
+    free(index->parents);
+    free(index->depth);
+    index->parents = NULL;
+    index->depth = NULL;
+}
+
+// every cell is reached once: a first walk up finds how far the nearest
+// cell with a depth is, a second one fills the cells on the way
+void path_index_depths(path_index_t *index){
+    index_t cells = (index_t)index->dim_x*index->dim_y;
+    if(!index->depth) index->depth = (uint32_t*) alloc_cells(cells,sizeof(uint32_t));
+    if(!index->depth) PERROR("Couldn't allocate the depths of a %u x %u maze",index->dim_x,index->dim_y);
+    uint32_t *depth = index->depth;
+    memset(depth,0xFF,cells*sizeof(uint32_t));
+    depth[index->root] = 0;
+
+    for(index_t cell = 0 ; cell < cells ; ++cell){
+        if(depth[cell] != NO_DEPTH) continue;
+        uint32_t steps = 0;
+        index_t i = cell;
+        for( ; depth[i] == NO_DEPTH ; ++steps)
+            i = path_index_step(index,i,path_index_parent(*index,i));
+        uint32_t known = depth[i] + steps;
+        for(i = cell ; depth[i] == NO_DEPTH ; --known){
+            depth[i] = known;
+            i = path_index_step(index,i,path_index_parent(*index,i));
+        }
+    }
+}
+
+// Depth first from the root, without a stack: the parent pointers lead
+// back, and a cell goes on with the direction after the one of the child
+// it comes back from. The cells are written to order as they are reached,
+// if it isn't NULL, and the number of them is returned. Walls open to the
+// outside of the maze are taken as closed
+static index_t walk_maze_tree(maze_t maze, path_index_t *index, uint32_t *order){
+    index_t cells = (index_t)index->dim_x*index->dim_y;
+    index->depth = (uint32_t*) alloc_cells(cells,sizeof(uint32_t));
+    if(!index->depth) PERROR("Couldn't allocate the depths of a %u x %u maze",index->dim_x,index->dim_y);
+    memset(index->depth,0xFF,cells*sizeof(uint32_t));
+
+    index_t root = index->root, cell = root, reached = 1;
+    index->depth[root] = 0;
+    if(order) order[0] = root;
+    uint8_t code = 0;
+    for(;;){
+        int_t x = cell % index->dim_x, y = cell / index->dim_x;
+        direction_t inside = (y > 0 ? NORTH : 0) | (x+1 < index->dim_x ? EAST : 0) |
+                             (y+1 < index->dim_y ? SOUTH : 0) | (x > 0 ? WEST : 0);
+        direction_t open = maze_at(maze,x,y).open_directions & inside;
+        for( ; code < 4 ; ++code){
+            if(!(open & (1 << code))) continue;
+            index_t next = path_index_step(index,cell,code);
+            if(index->depth[next] != NO_DEPTH) continue;
+            index->depth[next] = index->depth[cell] + 1;
+            index->parents[next >> 2] = (index->parents[next >> 2] & ~(3 << ((next & 3) << 1))) |
+                                        ((code ^ 2) << ((next & 3) << 1));
+            if(order) order[reached] = next;
+            reached++;
+            break;
+        }
+        if(code < 4){
+            cell = path_index_step(index,cell,code);
+            code = 0;
+            continue;
+        }
+        if(cell == root) break;
+        uint8_t up = path_index_parent(*index,cell);
+        cell = path_index_step(index,cell,up);
+        code = (up ^ 2) + 1;
+    }
+    return reached;
+}
+
+path_index_t path_index_from_maze(maze_t maze, index_t root){
+    path_index_t index;
+    alloc_path_index(&index,maze.dimensions.x,maze.dimensions.y);
+    index.root = root;
+    walk_maze_tree(maze,&index,NULL);
+    return index;
+}
+
+index_t path_index_ancestor(const path_index_t *index, index_t a, index_t b){
+    const uint32_t *depth = index->depth;
+    while(depth[a] > depth[b]) a = path_index_step(index,a,path_index_parent(*index,a));
+    while(depth[b] > depth[a]) b = path_index_step(index,b,path_index_parent(*index,b));
+    while(a != b){
+        a = path_index_step(index,a,path_index_parent(*index,a));
+        b = path_index_step(index,b,path_index_parent(*index,b));
+    }
+    return a;
+}
+
+index_t path_index_distance(const path_index_t *index, index_t a, index_t b){
+    index_t ancestor = path_index_ancestor(index,a,b);
+    return (index_t)index->depth[a] + index->depth[b] - 2*(index_t)index->depth[ancestor];
+}
+
+index_t path_index_path(const path_index_t *index, index_t a, index_t b, index_t *path){
+    index_t ancestor = path_index_ancestor(index,a,b);
+    index_t up = index->depth[a] - index->depth[ancestor];
+    index_t distance = up + index->depth[b] - index->depth[ancestor];
+    if(!path) return distance;
+    // a goes up from the start of the path, b from its end
+    for(index_t i = 0 ; i < up ; ++i, a = path_index_step(index,a,path_index_parent(*index,a)))
+        path[i] = a;
+    for(index_t i = distance ; i > up ; --i, b = path_index_step(index,b,path_index_parent(*index,b)))
+        path[i] = b;
+    path[up] = ancestor;
+    return distance;
+}
+
+
+
+// The lowest common ancestor of two cells is found on the depth first
+// preorder of the tree: for pre(a) < pre(b) it is the parent of the
+// shallowest cell at positions (pre(a), pre(b)], a range minimum over the
+// depths in preorder. The ranges go to blocks of 64 positions: a sparse
+// table over the blocks answers the whole blocks in between, and every
+// position keeps a bitmask of the positions of its block that are still a
+// minimum looking left from it, which answers the ends of the range.
+#define LCA_BLOCK 64
+
+typedef struct{
+    lca_index_t *index;
+    maze_t maze;
+    uint32_t level;             // of the sparse table being built
+    atomic_uint_fast64_t edges; // passages of the maze
+    atomic_uint_fast64_t bad;   // passages open on one side only
+} _lca_build_t;
+
+typedef void (*_lca_build_step_t)(_lca_build_t *build, uint64_t first, uint64_t last);
+
+typedef struct{
+    _lca_build_t *build;
+    _lca_build_step_t step;
+    uint64_t first, last;
+    uint8_t id, workers;
+} _lca_thread_args_t;
+
+static void * _lca_thread(void *void_args){
+    _lca_thread_args_t *args = (_lca_thread_args_t*) void_args;
+    pin_worker(args->id,args->workers);
+    args->step(args->build,args->first,args->last);
+    return NULL;
+}
+
+// step on [0,count), split in even shares between workers
+static void parallel_for(uint8_t workers, _lca_build_step_t step, _lca_build_t *build, uint64_t count){
+    if(workers <= 1 || count < workers){
+        step(build,0,count);
+        return;
+    }
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _lca_thread_args_t *args = calloc(workers,sizeof(_lca_thread_args_t));
+    if(!tid || !args) PERROR("Couldn't allocate space for threads while building the LCA index.");
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_lca_thread_args_t){build,step,count*i/workers,count*(i+1)/workers,i,workers};
+        pthread_create(&tid[i],NULL,_lca_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+    free(tid);
+    free(args);
+}
+
+// edges over rows, a tree has one less than cells. A passage open on one
+// side only counts as bad
+static void count_edges(_lca_build_t *build, uint64_t first_row, uint64_t last_row){
+    maze_t maze = build->maze;
+    uint64_t edges = 0, bad = 0;
+    for(int_t y = first_row ; y < last_row ; ++y){
+        for(int_t x = 0 ; x < maze.dimensions.x ; ++x){
+            direction_t open = maze_at(maze,x,y).open_directions;
+            bool east = x+1 < maze.dimensions.x && (maze_at(maze,x+1,y).open_directions & WEST);
+            bool south = y+1 < maze.dimensions.y && (maze_at(maze,x,y+1).open_directions & NORTH);
+            edges += east + south;
+            bad += (((open & EAST) != 0) != east) + (((open & SOUTH) != 0) != south) +
+                   ((open & NORTH) && y == 0) + ((open & WEST) && x == 0);
+        }
+    }
+    atomic_fetch_add(&build->bad,bad);
+    atomic_fetch_add(&build->edges,edges);
+}
+
+static void fill_preorder(_lca_build_t *build, uint64_t first, uint64_t last){
+    lca_index_t *index = build->index;
+    for(uint64_t i = first ; i < last ; ++i){
+        uint32_t cell = index->order[i];
+        index->preorder[cell] = i;
+        index->order_depth[i] = index->tree.depth[cell];
+    }
+}
+
+// bit j of masks[i] is set when position j of the block is the rightmost
+// minimum of [j, i]: the lowest bit at or after l is the minimum of [l, i]
+static void fill_blocks(_lca_build_t *build, uint64_t first_block, uint64_t last_block){
+    lca_index_t *index = build->index;
+    index_t cells = (index_t)index->tree.dim_x*index->tree.dim_y;
+    const uint32_t *depth = index->order_depth;
+    for(uint64_t block = first_block ; block < last_block ; ++block){
+        uint64_t start = block*LCA_BLOCK, end = start + LCA_BLOCK < cells ? start + LCA_BLOCK : cells;
+        uint64_t mask = 0;
+        for(uint64_t i = start ; i < end ; ++i){
+            while(mask && depth[start + 63 - __builtin_clzll(mask)] >= depth[i])
+                mask &= ~((uint64_t)1 << (63 - __builtin_clzll(mask)));
+            mask |= (uint64_t)1 << (i - start);
+            index->masks[i] = mask;
+        }
+        index->table[block] = start + __builtin_ctzll(index->masks[end-1]);
+    }
+}
+
+static inline uint32_t shallower(const lca_index_t *index, uint32_t a, uint32_t b){
+    return index->order_depth[b] < index->order_depth[a] ? b : a;
+}
+
+static void fill_table_level(_lca_build_t *build, uint64_t first_block, uint64_t last_block){
+    lca_index_t *index = build->index;
+    uint32_t level = build->level, half = 1 << (level-1);
+    uint32_t *previous = index->table + (uint64_t)(level-1)*index->blocks;
+    uint32_t *table = index->table + (uint64_t)level*index->blocks;
+    for(uint64_t block = first_block ; block < last_block ; ++block)
+        if(block + (1 << level) <= index->blocks)
+            table[block] = shallower(index,previous[block],previous[block+half]);
+}
+
+bool build_lca_index(maze_t maze, uint8_t workers, lca_index_t *index){
+    if(workers < 1) workers = 1;
+    int_t dim_x = maze.dimensions.x, dim_y = maze.dimensions.y;
+    index_t cells = (index_t)dim_x*dim_y;
+    memset(index,0,sizeof(lca_index_t));
+    alloc_path_index(&index->tree,dim_x,dim_y);
+    _lca_build_t build = {index,maze,0};
+    atomic_init(&build.edges,0);
+    atomic_init(&build.bad,0);
+
+    // a tree has one less passage than cells and reaches them all
+    parallel_for(workers,count_edges,&build,dim_y);
+    // a maze with walls open to the outside or on one side only isn't
+    // walked at all
+    if(atomic_load(&build.bad) || atomic_load(&build.edges) != cells-1){
+        free_lca_index(index);
+        return false;
+    }
+    index->order = (uint32_t*) alloc_cells(cells,sizeof(uint32_t));
+    if(!index->order) PERROR("Couldn't allocate the preorder of a %u x %u maze",dim_x,dim_y);
+    index_t reached = walk_maze_tree(maze,&index->tree,index->order);
+    if(reached != cells){
+        free_lca_index(index);
+        return false;
+    }
+
+    index->blocks = (cells + LCA_BLOCK-1)/LCA_BLOCK;
+    index->levels = 64 - __builtin_clzll(index->blocks);
+    index->preorder = (uint32_t*) alloc_cells(cells,sizeof(uint32_t));
+    index->order_depth = (uint32_t*) alloc_cells(cells,sizeof(uint32_t));
+    index->masks = (uint64_t*) alloc_cells(cells,sizeof(uint64_t));
+    index->table = (uint32_t*) alloc_cells((uint64_t)index->levels*index->blocks,sizeof(uint32_t));
+    if(!index->preorder || !index->order_depth || !index->masks || !index->table)
+        PERROR("Couldn't allocate the LCA index of a %u x %u maze",dim_x,dim_y);
+    parallel_for(workers,fill_preorder,&build,cells);
+    parallel_for(workers,fill_blocks,&build,index->blocks);
+    for(build.level = 1 ; build.level < index->levels ; ++build.level)
+        parallel_for(workers,fill_table_level,&build,index->blocks);
+    return true;
+}
+
+void free_lca_index(lca_index_t *index){
+    free_path_index(&index->tree);
+    free(index->order);
+    free(index->preorder);
+    free(index->order_depth);
+    free(index->masks);
+    free(index->table);
+    memset(index,0,sizeof(lca_index_t));
+}
+
+// position of the shallowest cell in [l, r] of the preorder
+static inline uint32_t shallowest(const lca_index_t *index, uint32_t l, uint32_t r){
+    uint32_t l_block = l / LCA_BLOCK, r_block = r / LCA_BLOCK;
+    if(l_block == r_block)
+        return r_block*LCA_BLOCK + __builtin_ctzll(index->masks[r] & (~(uint64_t)0 << (l % LCA_BLOCK)));
+    uint32_t best = shallower(index,
+        l_block*LCA_BLOCK + __builtin_ctzll(index->masks[l_block*LCA_BLOCK + LCA_BLOCK-1] & (~(uint64_t)0 << (l % LCA_BLOCK))),
+        r_block*LCA_BLOCK + __builtin_ctzll(index->masks[r]));
+    if(l_block+1 < r_block){
+        uint32_t blocks = r_block - l_block - 1, level = 31 - __builtin_clz(blocks);
+        const uint32_t *table = index->table + (uint64_t)level*index->blocks;
+        best = shallower(index,best,shallower(index,table[l_block+1],table[r_block - (1 << level)]));
+    }
+    return best;
+}
+
+index_t lca_index_ancestor(const lca_index_t *index, index_t a, index_t b){
+    if(a == b) return a;
+    uint32_t pre_a = index->preorder[a], pre_b = index->preorder[b];
+    if(pre_a > pre_b){
+        uint32_t swap = pre_a;
+        pre_a = pre_b;
+        pre_b = swap;
+    }
+    index_t child = index->order[shallowest(index,pre_a+1,pre_b)];
+    return path_index_step(&index->tree,child,path_index_parent(index->tree,child));
+}
+
+index_t lca_index_distance(const lca_index_t *index, index_t a, index_t b){
+    const uint32_t *depth = index->tree.depth;
+    return (index_t)depth[a] + depth[b] - 2*(index_t)depth[lca_index_ancestor(index,a,b)];
+}
+
+index_t lca_index_path(const lca_index_t *index, index_t a, index_t b, index_t *path){
+    const path_index_t *tree = &index->tree;
+    index_t ancestor = lca_index_ancestor(index,a,b);
+    index_t up = tree->depth[a] - tree->depth[ancestor];
+    index_t distance = up + tree->depth[b] - tree->depth[ancestor];
+    if(!path) return distance;
+    for(index_t i = 0 ; i < up ; ++i, a = path_index_step(tree,a,path_index_parent(*tree,a)))
+        path[i] = a;
+    for(index_t i = distance ; i > up ; --i, b = path_index_step(tree,b,path_index_parent(*tree,b)))
+        path[i] = b;
+    path[up] = ancestor;
+    return distance;
+}
@@ -1,9 +1,16 @@
 #include "solver.h"
 #include "visualization.h"
+#include "topology.h"
 #include <unistd.h>
 
 // Region size for mutex grid (each region is REGION_SIZE x REGION_SIZE cells)
 #define REGION_SIZE 2
+// A mutex is 40 bytes, 10 per cell with 2x2 regions: past this many mutexes
+// the regions double in side until the grid is back under it (64x64
+// regions and about 100MB of mutexes for a 100k x 100k maze)
+#define MAX_MUTEXES ((index_t)1 << 22)
+// held_region_mutex when the worker holds no region
+#define NO_REGION ((index_t)-1)
 
 vec2_t move_direction(vec2_t pos, direction_t dir) {
     vec2_t new_pos = pos;
@@ -28,12 +35,22 @@ direction_t opposite_direction(direction_t dir) {
     }
 }
 
+// Side of the regions of the mutex grid, REGION_SIZE unless the maze is too
+// big for that many mutexes
+static int_t calculate_region_size(vec2_t maze_dimensions) {
+    index_t region_size = REGION_SIZE;
+    while (((maze_dimensions.x + region_size - 1) / region_size) *
+           ((maze_dimensions.y + region_size - 1) / region_size) > MAX_MUTEXES)
+        region_size *= 2;
+    return region_size;
+}
+
 // Calculates mutex grid dimensions based on maze size
-static vec2_t calculate_mutex_grid_dimensions(vec2_t maze_dimensions) {
-    // Divide maze into regions (each region is REGION_SIZE x REGION_SIZE cells)
+static vec2_t calculate_mutex_grid_dimensions(vec2_t maze_dimensions, int_t region_size) {
+    // Divide maze into regions (each region is region_size x region_size cells)
     
-    int_t grid_x = (maze_dimensions.x + REGION_SIZE - 1) / REGION_SIZE;  // Ceiling division
-    int_t grid_y = (maze_dimensions.y + REGION_SIZE - 1) / REGION_SIZE;
+    int_t grid_x = (maze_dimensions.x + region_size - 1) / region_size;  // Ceiling division
+    int_t grid_y = (maze_dimensions.y + region_size - 1) / region_size;
     
     // Ensure at least 1x1
     if (grid_x < 1) grid_x = 1;
@@ -42,15 +59,23 @@ static vec2_t calculate_mutex_grid_dimensions(vec2_t maze_dimensions) {
     return (vec2_t){grid_x, grid_y};
 }
 
-// Allocates an exploration map matching the maze dimensions
-static void alloc_exploration_map(exploration_map_t *exp_map, maze_t maze) {
+// Initializes a band of the mutex grid, on the node of the worker of the band
+static void init_mutex_band(uint64_t first, uint64_t last, void *mutexes) {
+    for (uint64_t i = first; i < last; i++) {
+        pthread_mutex_init(&((pthread_mutex_t*) mutexes)[i], NULL);
+    }
+}
+
+// Allocates an exploration map matching the maze dimensions, its bands of
+// rows on the nodes of the workers that take the same bands
+static void alloc_exploration_map(exploration_map_t *exp_map, maze_t maze, uint8_t num_workers) {
     exp_map->dimensions = maze.dimensions;
     exp_map->true_dimensions = maze.true_dimensions;
     exp_map->start = maze.start;
     
     // Allocate and initialize to false (unexplored)
-    size_t size = maze.true_dimensions.x * maze.true_dimensions.y;
-    exp_map->data = (bool*) calloc(size, sizeof(bool));
+    index_t size = (index_t)maze.true_dimensions.x * maze.true_dimensions.y;
+    exp_map->data = (bool*) alloc_cells_for_workers(size, sizeof(bool), num_workers);
     
     if (!exp_map->data) {
         PERROR("Couldn't allocate exploration map with size: %d x %d", 
@@ -58,36 +83,44 @@ static void alloc_exploration_map(exploration_map_t *exp_map, maze_t maze) {
     }
     
     // Allocate exploration tracking array
-    exp_map->explored_from = (direction_t*) calloc(size, sizeof(direction_t));
+    exp_map->explored_from = (direction_t*) alloc_cells_for_workers(size, sizeof(direction_t), num_workers);
     
     if (!exp_map->explored_from) {
         PERROR("Couldn't allocate exploration tracking array");
     }
     
+    // Allocate worker ownership array
+    exp_map->explored_by = (uint8_t*) alloc_cells_for_workers(size, sizeof(uint8_t), num_workers);
+    
+    if (!exp_map->explored_by) {
+        PERROR("Couldn't allocate exploration ownership array");
+    }
+    
     // Initialize mutex grid
-    exp_map->mutex_grid.grid_dimensions = calculate_mutex_grid_dimensions(maze.dimensions);
-    exp_map->mutex_grid.region_size = REGION_SIZE;
+    exp_map->mutex_grid.region_size = calculate_region_size(maze.dimensions);
+    exp_map->mutex_grid.grid_dimensions = calculate_mutex_grid_dimensions(maze.dimensions,
+                                                                          exp_map->mutex_grid.region_size);
     
-    size_t num_mutexes = exp_map->mutex_grid.grid_dimensions.x * exp_map->mutex_grid.grid_dimensions.y;
-    exp_map->mutex_grid.mutexes = (pthread_mutex_t*) malloc(num_mutexes * sizeof(pthread_mutex_t));
+    size_t num_mutexes = (size_t)exp_map->mutex_grid.grid_dimensions.x * exp_map->mutex_grid.grid_dimensions.y;
+    exp_map->mutex_grid.mutexes = (pthread_mutex_t*) alloc_cells_for_workers(num_mutexes, sizeof(pthread_mutex_t),
+                                                                                  num_workers);
     
     if (!exp_map->mutex_grid.mutexes) {
         PERROR("Couldn't allocate mutex grid with size: %d x %d", 
                exp_map->mutex_grid.grid_dimensions.x, exp_map->mutex_grid.grid_dimensions.y);
     }
     
-    // Initialize all mutexes
-    for (size_t i = 0; i < num_mutexes; i++) {
-        pthread_mutex_init(&exp_map->mutex_grid.mutexes[i], NULL);
-    }
+    // Initialize all mutexes, in the same bands as the pages were touched
+    run_pinned_bands(num_workers, num_mutexes, init_mutex_band, exp_map->mutex_grid.mutexes);
 }
 
 // Frees the exploration map
 static void free_exploration_map(exploration_map_t *exp_map) {
     free(exp_map->data);
     free(exp_map->explored_from);
+    free(exp_map->explored_by);
     
-    size_t num_mutexes = exp_map->mutex_grid.grid_dimensions.x * 
+    size_t num_mutexes = (size_t)exp_map->mutex_grid.grid_dimensions.x * 
                          exp_map->mutex_grid.grid_dimensions.y;
     
     // Destroy all mutexes
@@ -98,15 +131,15 @@ static void free_exploration_map(exploration_map_t *exp_map) {
     free(exp_map->mutex_grid.mutexes);
 }
 
-static void init_bifurcation_buffer(bifurcation_buffer_t *buffer, int_t capacity) {
+static void init_bifurcation_buffer(bifurcation_buffer_t *buffer, index_t capacity, uint8_t num_workers) {
     buffer->capacity = capacity;
     buffer->head = 0;
     buffer->tail = 0;
     buffer->count = 0;
     
-    buffer->data = (bifurcation_t*) malloc(capacity * sizeof(bifurcation_t));
+    buffer->data = (bifurcation_t*) alloc_cells_for_workers(capacity, sizeof(bifurcation_t), num_workers);
     if (!buffer->data) {
-        PERROR("Couldn't allocate bifurcation buffer with capacity: %d", capacity);
+        PERROR("Couldn't allocate bifurcation buffer with capacity: %lu", (unsigned long)capacity);
     }
     
     pthread_mutex_init(&buffer->mutex, NULL);
@@ -146,25 +179,30 @@ void init_solver_state(solver_state_t *state, maze_t maze, uint8_t num_workers,
     state->shutdown = false;
     state->active_workers = 0;
     state->enable_visualization = enable_iterative_visualization;
+    state->solution_path.cells = NULL;
+    state->solution_path.length = 0;
     
     // Allocate exploration map (includes mutex grid initialization)
-    alloc_exploration_map(&state->explored, maze);
+    alloc_exploration_map(&state->explored, maze, num_workers);
     
     // Initialize bifurcation buffer (capacity based on maze size)
-    int_t buffer_capacity = (maze.dimensions.x * maze.dimensions.y)/4;
-    init_bifurcation_buffer(&state->bifurcations, buffer_capacity);
+    index_t buffer_capacity = ((index_t)maze.dimensions.x * maze.dimensions.y)/4;
+    if (buffer_capacity < 1) buffer_capacity = 1;
+    init_bifurcation_buffer(&state->bifurcations, buffer_capacity, num_workers);
     
     // Allocate worker position tracking
-    state->worker_positions = (worker_position_t*) calloc(num_workers, sizeof(worker_position_t));
+    state->worker_positions = (worker_position_t*) aligned_alloc(_Alignof(worker_position_t),
+                                                                 num_workers * sizeof(worker_position_t));
     if (!state->worker_positions) {
         PERROR("Couldn't allocate worker positions array");
     }
     
     for (uint8_t i = 0; i < num_workers; i++) {
-        state->worker_positions[i].is_active = false;
+        atomic_init(&state->worker_positions[i].sequence, 0);
+        atomic_init(&state->worker_positions[i].x, 0);
+        atomic_init(&state->worker_positions[i].y, 0);
+        atomic_init(&state->worker_positions[i].is_active, false);
     }
-    
-    pthread_mutex_init(&state->viz_mutex, NULL);
 }
 
 // Cleans up solver state
@@ -172,7 +210,7 @@ void cleanup_solver_state(solver_state_t *state) {
     free_exploration_map(&state->explored);
     free(state->worker_positions);
     free_bifurcation_buffer(&state->bifurcations);
-    pthread_mutex_destroy(&state->viz_mutex);
+    free(state->solution_path.cells);
 }
 
 
@@ -208,11 +246,12 @@ static void* solver_worker(void *args) {
     solver_state_t *state = worker->state;
     uint8_t worker_id = worker->worker_id;
     uint32_t speed = worker->speed;
+    pin_worker(worker_id, state->num_workers);
     
     vec2_t current_position;
     direction_t entry_direction = 0;  
     bool is_actively_exploring = false;
-    int_t held_region_mutex = -1;  
+    index_t held_region_mutex = NO_REGION;
     
     if (worker_id == 0) {
         current_position = (vec2_t){0, 0};
@@ -237,7 +276,7 @@ static void* solver_worker(void *args) {
                 }
                 decrement_active_workers(state);
             }
-            if (held_region_mutex != -1) {
+            if (held_region_mutex != NO_REGION) {
                 pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
             }
             break;
@@ -287,19 +326,19 @@ static void* solver_worker(void *args) {
                 increment_active_workers(state);
                 
                 // Release old region mutex if moving to a new region
-                int_t new_region = get_mutex_index(state->explored, current_position.x, current_position.y);
-                if (held_region_mutex != -1 && held_region_mutex != new_region) {
+                index_t new_region = get_mutex_index(state->explored, current_position.x, current_position.y);
+                if (held_region_mutex != NO_REGION && held_region_mutex != new_region) {
                     pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
-                    held_region_mutex = -1;
+                    held_region_mutex = NO_REGION;
                 }
             } else {
                 continue;
             }
         }
         
-        int_t region_mutex_idx = get_mutex_index(state->explored, current_position.x, current_position.y);
+        index_t region_mutex_idx = get_mutex_index(state->explored, current_position.x, current_position.y);
         if (held_region_mutex != region_mutex_idx) {
-            if (held_region_mutex != -1) {
+            if (held_region_mutex != NO_REGION) {
                 pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
             }
             pthread_mutex_lock(&state->explored.mutex_grid.mutexes[region_mutex_idx]);
@@ -311,16 +350,17 @@ static void* solver_worker(void *args) {
             explored_at(state->explored, current_position.x, current_position.y) = true;
             
             // Save where im from for path reconstruction
-            int_t cell_idx = state->explored.start + current_position.x + 
-                            current_position.y * state->explored.true_dimensions.x;
+            index_t cell_idx = state->explored.start + current_position.x + 
+                            (index_t)current_position.y * state->explored.true_dimensions.x;
             state->explored.explored_from[cell_idx] = entry_direction;
+            state->explored.explored_by[cell_idx] = worker_id;
         }
         
         if (cell_already_explored) {
 
-            if (held_region_mutex != -1) {
+            if (held_region_mutex != NO_REGION) {
                 pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
-                held_region_mutex = -1;
+                held_region_mutex = NO_REGION;
             }
             
             if (state->enable_visualization) {
@@ -335,9 +375,9 @@ static void* solver_worker(void *args) {
         bool reached_goal = (current_position.x == state->goal.x && current_position.y == state->goal.y);
         if (reached_goal) {
             // Release region mutex
-            if (held_region_mutex != -1) {
+            if (held_region_mutex != NO_REGION) {
                 pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
-                held_region_mutex = -1;
+                held_region_mutex = NO_REGION;
             }
             
             if (state->enable_visualization) {
@@ -358,9 +398,9 @@ static void* solver_worker(void *args) {
         int num_paths = count_directions(unexplored_directions);
         
         if (num_paths == 0) {
-            if (held_region_mutex != -1) {
+            if (held_region_mutex != NO_REGION) {
                 pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
-                held_region_mutex = -1;
+                held_region_mutex = NO_REGION;
             }
             
             if (state->enable_visualization) {
@@ -421,28 +461,18 @@ static void* solver_worker(void *args) {
         }
     }
     
-    if (held_region_mutex != -1) {
+    if (held_region_mutex != NO_REGION) {
         pthread_mutex_unlock(&state->explored.mutex_grid.mutexes[held_region_mutex]);
     }
     free(worker);
     return NULL;
 }
 
-void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualization, uint32_t speed) {
-    
-    wprintf(L"Starting maze solver with %d workers\n", num_workers);
-    wprintf(L"Maze dimensions: %d x %d\n", maze.dimensions.x, maze.dimensions.y);
-    wprintf(L"Goal: (%d, %d)\n", maze.dimensions.x - 1, maze.dimensions.y - 1);
-    
-    if (!enable_iterative_visualization) {
-        wprintf(L"\n=== INITIAL MAZE ===\n");
-        print_maze(maze);
-        wprintf(L"\n");
-    }
-    
-    solver_state_t state;
-    init_solver_state(&state, maze, num_workers, enable_iterative_visualization);
-    state.speed = speed;
+// Runs the worker threads (and the visualizer) on an initialized state
+// until the goal is found or every reachable cell was explored
+void run_solver(solver_state_t *state, uint32_t speed) {
+    uint8_t num_workers = state->num_workers;
+    state->speed = speed;
     
     pthread_t *threads = (pthread_t*) malloc(num_workers * sizeof(pthread_t));
     if (!threads) {
@@ -450,8 +480,8 @@ void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualiz
     }
     
     pthread_t viz_thread;
-    if (enable_iterative_visualization) {
-        pthread_create(&viz_thread, NULL, visualizer_thread, (void*)&state);
+    if (state->enable_visualization) {
+        pthread_create(&viz_thread, NULL, visualizer_thread, (void*)state);
     }
     usleep(200);
     for (uint8_t i = 0; i < num_workers; i++) {
@@ -460,7 +490,7 @@ void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualiz
             PERROR("Couldn't allocate worker args for thread %d", i);
         }
         
-        args->state = &state;
+        args->state = state;
         args->worker_id = i;
         args->speed = speed;
         
@@ -471,9 +501,41 @@ void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualiz
         pthread_join(threads[i], NULL);
     }
     
-    if (enable_iterative_visualization) {
+    if (state->enable_visualization) {
         pthread_join(viz_thread, NULL);
-        
+    }
+    
+    free(threads);
+}
+
+void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualization, uint32_t speed) {
+    
+    wprintf(L"Starting maze solver with %d workers\n", num_workers);
+    wprintf(L"Maze dimensions: %d x %d\n", maze.dimensions.x, maze.dimensions.y);
+    wprintf(L"Goal: (%d, %d)\n", maze.dimensions.x - 1, maze.dimensions.y - 1);
+    
+    // Mazes larger than the terminal are shown through a viewport and an
+    // overview, so printing them costs as much as the terminal can show
+    vec2_t terminal = terminal_size();
+    vec2_t view_size = viewport_size_for_terminal(terminal);
+    bool fits_terminal = terminal.x == 0 ||
+                         (maze.dimensions.x <= view_size.x && maze.dimensions.y <= view_size.y);
+    
+    if (!enable_iterative_visualization) {
+        wprintf(L"\n=== INITIAL MAZE ===\n");
+        if (fits_terminal) {
+            print_maze(maze);
+        } else {
+            print_maze_viewport(maze, viewport_around(maze, (vec2_t){0, 0}, view_size));
+        }
+        wprintf(L"\n");
+    }
+    
+    solver_state_t state;
+    init_solver_state(&state, maze, num_workers, enable_iterative_visualization);
+    run_solver(&state, speed);
+    
+    if (enable_iterative_visualization) {
         // Clear screen and show final result
         wprintf(L"\033[2J\033[H");
     }
@@ -481,14 +543,23 @@ void solve_maze(maze_t maze, uint8_t num_workers, bool enable_iterative_visualiz
     if (state.solution_found) {
         wprintf(L"\n✓ Solution found!\n");
         wprintf(L"\n=== SOLUTION PATH ===\n");
-        print_maze_with_solution(&state);
+        if (fits_terminal) {
+            print_maze_with_solution(&state);
+        } else {
+            print_maze_overview(&state, (vec2_t){terminal.x, view_size.y});
+            wprintf(L"\n=== AROUND THE GOAL ===\n");
+            print_maze_with_solution_viewport(&state, viewport_around_goal(&state, view_size));
+        }
     } else {
         wprintf(L"\n✗ No solution found.\n");
         wprintf(L"\n=== EXPLORED CELLS ===\n");
-        print_maze_explored(&state);
+        if (fits_terminal) {
+            print_maze_explored(&state);
+        } else {
+            print_maze_overview(&state, (vec2_t){terminal.x, view_size.y});
+        }
     }
     wprintf(L"\n");
     
-    free(threads);
     cleanup_solver_state(&state);
 }
@@ -1,4 +1,64 @@
 #include "maze.h"
+#include "special_characters.h"
+
+
+
+// box characters indexed by the open directions <WSEN>, dead ends
+// (a single open direction) are drawn as blanks
+static const spchar_t box_chars[16] = {
+    [0]                         = L' ',
+    [NORTH]                     = L' ',
+    [SOUTH]                     = L' ',
+    [EAST]                      = L' ',
+    [WEST]                      = L' ',
+
+    [NORTH | EAST]              = L'╚',
+    [NORTH | SOUTH]             = L'║',
+    [NORTH | WEST]              = L'╝',
+    [EAST | SOUTH]              = L'╔',
+    [EAST | WEST]               = L'═',
+    [SOUTH | WEST]              = L'╗',
+
+    [NORTH | EAST | SOUTH]      = L'╠',
+    [NORTH | EAST | WEST]       = L'╩',
+    [NORTH | SOUTH | WEST]      = L'╣',
+    [EAST | SOUTH | WEST]       = L'╦',
+    [NORTH | EAST | SOUTH | WEST] = L'╬',
+};
+
+// same table, already UTF-8 encoded
+const utf8_glyph_t box_glyphs_utf8[16] = {
+    [0]                         = {" ", 1},
+    [NORTH]                     = {" ", 1},
+    [SOUTH]                     = {" ", 1},
+    [EAST]                      = {" ", 1},
+    [WEST]                      = {" ", 1},
+
+    [NORTH | EAST]              = {"╚", 3},
+    [NORTH | SOUTH]             = {"║", 3},
+    [NORTH | WEST]              = {"╝", 3},
+    [EAST | SOUTH]              = {"╔", 3},
+    [EAST | WEST]               = {"═", 3},
+    [SOUTH | WEST]              = {"╗", 3},
+
+    [NORTH | EAST | SOUTH]      = {"╠", 3},
+    [NORTH | EAST | WEST]       = {"╩", 3},
+    [NORTH | SOUTH | WEST]      = {"╣", 3},
+    [EAST | SOUTH | WEST]       = {"╦", 3},
+    [NORTH | EAST | SOUTH | WEST] = {"╬", 3},
+};
+
+const utf8_glyph_t connector_glyphs_utf8[2] = {
+    {" ", 1},
+    {"═", 3},
+};
+
+spchar_t get_box_char(direction_t dirs) {
+    if (dirs > (NORTH | EAST | SOUTH | WEST)) return L'?';
+    return box_chars[dirs];
+}
+
+
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -6,49 +66,6 @@
 #include <wchar.h>
 #include <stdint.h>
 
-typedef wchar_t spchar_t;
-
-spchar_t get_box_char(direction_t dirs) {
-    switch (dirs) {
-        case 0:
-            return L' ';
-        case NORTH: 
-            return L' ';
-        case SOUTH: 
-            return L' ';
-        case EAST:
-            return L' '; 
-        case WEST:
-            return L' ';
-
-        case NORTH | EAST:
-            return L'╚';
-        case NORTH | SOUTH:
-            return L'║';
-        case NORTH | WEST:
-            return L'╝';
-        case EAST | SOUTH:
-            return L'╔';
-        case EAST | WEST:
-            return L'═';
-        case SOUTH | WEST:
-            return L'╗';
-
-        case NORTH | EAST | SOUTH:
-            return L'╠';
-        case NORTH | EAST | WEST:
-            return L'╩';
-        case NORTH | SOUTH | WEST:
-            return L'╣';
-        case EAST | SOUTH | WEST:
-            return L'╦';
-        case NORTH | EAST | SOUTH | WEST:
-            return L'╬';
-        default:
-            return L'?'; 
-    }
-}
-
 void print_spchar(spchar_t ch) {
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     if (hConsole == INVALID_HANDLE_VALUE) return;
@@ -64,49 +81,6 @@ void print_spchar(spchar_t ch) {
 #include <locale.h>
 #include <stdarg.h>
 
-typedef wchar_t spchar_t;
-spchar_t get_box_char(direction_t dirs) {
-    switch (dirs) {
-        case 0:
-            return L' ';
-        case NORTH: 
-            return L' ';
-        case SOUTH: 
-            return L' ';
-        case EAST:
-            return L' '; 
-        case WEST:
-            return L' ';
-
-        case NORTH | EAST:
-            return L'╚';
-        case NORTH | SOUTH:
-            return L'║';
-        case NORTH | WEST:
-            return L'╝';
-        case EAST | SOUTH:
-            return L'╔';
-        case EAST | WEST:
-            return L'═';
-        case SOUTH | WEST:
-            return L'╗';
-
-        case NORTH | EAST | SOUTH:
-            return L'╠';
-        case NORTH | EAST | WEST:
-            return L'╩';
-        case NORTH | SOUTH | WEST:
-            return L'╣';
-        case EAST | SOUTH | WEST:
-            return L'╦';
-        case NORTH | EAST | SOUTH | WEST:
-            return L'╬';
-        default:
-            return L'?'; 
-    }
-}
-
-
 static bool locale_is_set = false;
 
 void print_spchar(spchar_t ch){
@@ -116,4 +90,32 @@ void print_spchar(spchar_t ch){
     }
     wprintf(L"%lc",ch);
 }
-#endif
\ No newline at end of file
+#endif
+
+
+
+// independent from the locale, so buffered renderers can build
+// their output in plain bytes and hand it straight to write(2)
+size_t spchar_to_utf8(spchar_t ch, char *out){
+    uint32_t code = (uint32_t)ch;
+    if(code < 0x80){
+        out[0] = (char)code;
+        return 1;
+    }
+    if(code < 0x800){
+        out[0] = (char)(0xC0 | (code>>6));
+        out[1] = (char)(0x80 | (code&0x3F));
+        return 2;
+    }
+    if(code < 0x10000){
+        out[0] = (char)(0xE0 | (code>>12));
+        out[1] = (char)(0x80 | ((code>>6)&0x3F));
+        out[2] = (char)(0x80 | (code&0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code>>18));
+    out[1] = (char)(0x80 | ((code>>12)&0x3F));
+    out[2] = (char)(0x80 | ((code>>6)&0x3F));
+    out[3] = (char)(0x80 | (code&0x3F));
+    return 4;
+}
\ No newline at end of file
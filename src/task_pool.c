@@ -0,0 +1,138 @@
+#include "task_pool.h"
+#include "topology.h"
+#include "random.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// The deques are rings guarded by a mutex each: the owner and the thieves
+// only meet on the same deque when it is nearly empty, and the tasks worth
+// spawning are big, so a lock is cheaper than it looks here.
+
+#define INITIAL_DEQUE_CAPACITY 64
+
+typedef struct{
+    task_function_t function;
+    uint8_t payload[TASK_PAYLOAD_SIZE];
+} task_t;
+
+typedef struct{
+    pthread_mutex_t lock;
+    task_t *tasks;
+    size_t capacity, top, bottom;   // tasks in [top, bottom), modulo capacity
+} _task_deque_t;
+
+struct task_pool{
+    _task_deque_t *deques;
+    uint8_t workers;
+    atomic_size_t unfinished;       // spawned tasks not finished yet
+};
+
+typedef struct{
+    task_pool_t *pool;
+    uint8_t id;
+} _task_worker_args_t;
+
+
+
+void task_pool_spawn(task_pool_t *pool, uint8_t worker, task_function_t function,
+                     const void *payload, size_t size){
+    if(size > TASK_PAYLOAD_SIZE) PERROR("Task payload of %lu bytes, at most %d fit.",(unsigned long)size,TASK_PAYLOAD_SIZE);
+    atomic_fetch_add(&pool->unfinished,1);
+    _task_deque_t *deque = &pool->deques[worker];
+    pthread_mutex_lock(&deque->lock);
+    if(deque->bottom - deque->top == deque->capacity){
+        task_t *tasks = (task_t*) malloc(2*deque->capacity*sizeof(task_t));
+        if(!tasks) PERROR("Couldn't grow the deque of worker %d to %lu tasks.",worker,(unsigned long)(2*deque->capacity));
+        for(size_t i = deque->top ; i < deque->bottom ; ++i)
+            tasks[i - deque->top] = deque->tasks[i % deque->capacity];
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        deque->capacity *= 2;
+    }
+    task_t *task = &deque->tasks[deque->bottom % deque->capacity];
+    task->function = function;
+    memcpy(task->payload,payload,size);
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// newest task of the worker's own deque
+static bool pop_task(_task_deque_t *deque, task_t *task){
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom > deque->top;
+    if(found) *task = deque->tasks[--deque->bottom % deque->capacity];
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// oldest task of someone else's deque
+static bool steal_task(_task_deque_t *deque, task_t *task){
+    if(pthread_mutex_trylock(&deque->lock)) return false;
+    bool found = deque->bottom > deque->top;
+    if(found) *task = deque->tasks[deque->top++ % deque->capacity];
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void * _task_worker_thread(void *void_args){
+    _task_worker_args_t *args = (_task_worker_args_t*) void_args;
+    task_pool_t *pool = args->pool;
+    pin_worker(args->id,pool->workers);
+    random_t random;
+    seed_random_stream(&random,(uint64_t)(uintptr_t)pool,args->id);
+
+    task_t task;
+    while(atomic_load(&pool->unfinished) > 0){
+        bool found = pop_task(&pool->deques[args->id],&task);
+        for(uint8_t tries = 0 ; !found && tries < pool->workers ; ++tries){
+            uint8_t victim = random_below(&random,pool->workers);
+            if(victim != args->id) found = steal_task(&pool->deques[victim],&task);
+        }
+        if(!found){
+            sched_yield();
+            continue;
+        }
+        task.function(pool,task.payload,args->id);
+        atomic_fetch_sub(&pool->unfinished,1);
+    }
+    return NULL;
+}
+
+
+
+void task_pool_run(uint8_t workers, task_function_t function, const void *payload, size_t size){
+    if(workers == 0) workers = 1;
+    task_pool_t pool;
+    pool.workers = workers;
+    atomic_init(&pool.unfinished,0);
+    pool.deques = (_task_deque_t*) calloc(workers,sizeof(_task_deque_t));
+    pthread_t *tid = calloc(workers,sizeof(pthread_t));
+    _task_worker_args_t *args = calloc(workers,sizeof(_task_worker_args_t));
+    if(!pool.deques || !tid || !args) PERROR("Couldn't allocate a task pool of %d workers.",workers);
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        pthread_mutex_init(&pool.deques[i].lock,NULL);
+        pool.deques[i].capacity = INITIAL_DEQUE_CAPACITY;
+        pool.deques[i].tasks = (task_t*) malloc(INITIAL_DEQUE_CAPACITY*sizeof(task_t));
+        if(!pool.deques[i].tasks) PERROR("Couldn't allocate the deque of worker %d.",i);
+    }
+
+    task_pool_spawn(&pool,0,function,payload,size);
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_task_worker_args_t){&pool,i};
+        pthread_create(&tid[i],NULL,_task_worker_thread,(void*)&args[i]);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        pthread_join(tid[i],NULL);
+
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        pthread_mutex_destroy(&pool.deques[i].lock);
+        free(pool.deques[i].tasks);
+    }
+    free(pool.deques);
+    free(tid);
+    free(args);
+}
@@ -1,16 +1,40 @@
 #include "common.h"
 #include "maze.h"
 #include "solver.h"
+#include "visualization.h"
+#include "image_export.h"
+#include "maze_file.h"
+#include "tiled_maze.h"
+#include "maze_packed.h"
+#include "path_index.h"
+#include "maze_analysis.h"
+#include "random.h"
 #include <locale.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <wchar.h>
 
+// seed of every generated maze, MAZE_SEED or the current time
+static uint64_t seed;
+
+// creates a file for a test under TMPDIR (/tmp if unset) and returns it
+// open, path gets its name. The test unlinks it when it is done
+#define TEMP_PATH_SIZE 4096
+static int open_temp_file(char *path, const char *suffix) {
+  const char *dir = getenv("TMPDIR");
+  snprintf(path, TEMP_PATH_SIZE, "%s/maze-XXXXXX%s", dir && *dir ? dir : "/tmp",
+           suffix);
+  int fd = mkstemps(path, strlen(suffix));
+  if (fd < 0) PERROR("Couldn't create temporary file %s", path);
+  return fd;
+}
+
 #define description_1 "generates a 50x50 maze"
 void test_1() {
   uint64_t iterations = 50 * 50 * 50;
-  maze_t maze = generate_random_maze_MCMC(50, 50, iterations);
+  maze_t maze = generate_random_maze_MCMC(50, 50, iterations, seed);
   // print_maze(maze);
   uint32_t speed = 5000;
   bool iterative_visualization = true;
@@ -22,7 +46,7 @@ void test_1() {
 void test_2() {
   for (uint64_t size = 10; size <= 100; size += 10) {
     uint64_t iterations = size * size * size;
-    maze_t maze = generate_random_maze_MCMC(size, size, iterations);
+    maze_t maze = generate_random_maze_MCMC(size, size, iterations, seed);
     // print_maze(maze);
     uint32_t speed = 5000;
     bool iterative_visualization = true;
@@ -33,7 +57,7 @@ void test_2() {
 
 #define description_3 "generates a 500x500 maze"
 void test_3() {
-  maze_t maze = generate_random_maze_MCMC(500, 500, 125000100);
+  maze_t maze = generate_random_maze_MCMC(500, 500, 125000100, seed);
   // print_maze(maze);
   uint32_t speed = 0;
   bool iterative_visualization = false;
@@ -42,14 +66,13 @@ void test_3() {
 }
 
 #define description_4                                                          \
-  "generates as 32x32 maze in parallel (has loops, not a perfect maze)"
+  "generates as 32x32 maze in parallel"
 void test_4() {
   int_t size = 32;
   uint64_t iterations = size * size * size + 100;
-  uint8_t power = log2l(CPU_CORES);
-  uint8_t workers = 1 << power;
+  uint8_t workers = CPU_CORES;
   maze_t maze =
-      generate_random_maze_MCMC_parallel(size, size, iterations, workers);
+      generate_random_maze_MCMC_parallel(size, size, iterations, workers, seed);
   // print_maze(maze);
   uint32_t speed = 5000;
   bool iterative_visualization = true;
@@ -61,7 +84,7 @@ void test_4() {
 void test_5() {
   int_t size = 10;
   uint64_t iterations = size * size * size;
-  maze_t maze = generate_random_maze_MCMC(size, size, iterations);
+  maze_t maze = generate_random_maze_MCMC(size, size, iterations, seed);
   print_maze(maze);
   printf("----\n");
   maze_t sub_mazes[4];
@@ -77,10 +100,9 @@ void test_5() {
 void test_6() {
   int_t size = 1024;
   uint64_t iterations = size * size * size + 100;
-  uint8_t power = log2l(CPU_CORES);
-  uint8_t workers = 1 << power;
+  uint8_t workers = CPU_CORES;
   maze_t maze =
-      generate_random_maze_MCMC_parallel(size, size, iterations, workers);
+      generate_random_maze_MCMC_parallel(size, size, iterations, workers, seed);
   // print_maze(maze);
   uint32_t speed = 0;
   bool iterative_visualization = false;
@@ -91,7 +113,7 @@ void test_6() {
 #define description_7 "generates a 64 x 64 maze with hillbert lookahead"
 void test_7() {
   clock_t start = clock();
-  maze_t maze = generate_random_maze_hillbert_lookahead(64);
+  maze_t maze = generate_random_maze_hillbert_lookahead(64, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -104,7 +126,7 @@ void test_7() {
 #define description_8 "generates a 8.192 x 8.192 maze with hillbert lookahead"
 void test_8() {
   clock_t start = clock();
-  generate_random_maze_hillbert_lookahead(8192);
+  generate_random_maze_hillbert_lookahead(8192, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -113,7 +135,7 @@ void test_8() {
 #define description_9 "generates a 1024 x 1024 maze with hillbert lookahead"
 void test_9() {
   clock_t start = clock();
-  maze_t maze = generate_random_maze_hillbert_lookahead(1024);
+  maze_t maze = generate_random_maze_hillbert_lookahead(1024, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -126,7 +148,7 @@ void test_9() {
 #define description_10 "generates a 256 x 256 maze with hillbert lookahead"
 void test_10() {
   clock_t start = clock();
-  maze_t maze = generate_random_maze_hillbert_lookahead(256);
+  maze_t maze = generate_random_maze_hillbert_lookahead(256, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -140,7 +162,7 @@ void test_10() {
 #define description_11 "generates a 128 x 128 maze with hillbert lookahead"
 void test_11() {
   clock_t start = clock();
-  maze_t maze = generate_random_maze_hillbert_lookahead(128);
+  maze_t maze = generate_random_maze_hillbert_lookahead(128, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -154,7 +176,7 @@ void test_11() {
 #define description_12 "generates a 32 x 32 maze with hillbert lookahead"
 void test_12() {
   clock_t start = clock();
-  maze_t maze = generate_random_maze_hillbert_lookahead(32);
+  maze_t maze = generate_random_maze_hillbert_lookahead(32, CPU_CORES, seed);
   clock_t end = clock();
   float seconds = (float)(end - start) / CLOCKS_PER_SEC;
   printf("finished after %.4fs...\n", seconds);
@@ -168,7 +190,7 @@ void test_12() {
 #define description_13 "generates and solves a small 8x8 maze"
 void test_13() {
   uint64_t iterations = 8 * 8 * 8;
-  maze_t maze = generate_random_maze_MCMC(8, 8, iterations);
+  maze_t maze = generate_random_maze_MCMC(8, 8, iterations, seed);
   // print_maze(maze);
   uint32_t speed = 300000;
   bool iterative_visualization = true;
@@ -179,7 +201,7 @@ void test_13() {
 #define description_14 "small test - 5x5 maze visualization"
 void test_14() {
   uint64_t iterations = 5 * 5 * 5;
-  maze_t maze = generate_random_maze_MCMC(5, 5, iterations);
+  maze_t maze = generate_random_maze_MCMC(5, 5, iterations, seed);
   print_maze(maze);
   uint32_t speed = 0;
   bool iterative_visualization = false;
@@ -273,7 +295,7 @@ void test_18() {
   "other"
 void test_19() {
   int_t side = 32;
-  maze_t maze = generate_random_maze_hillbert_lookahead(side);
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
   for (int i = 0; i < side; ++i) {
     maze_at(maze, 15, i).open_directions = 0;
   }
@@ -288,7 +310,7 @@ void test_19() {
   "generates a 64x64 maze and solve it with 1, 2, 6 and 12 threads"
 void test_20() {
   int_t side = 64;
-  maze_t maze = generate_random_maze_hillbert_lookahead(side);
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
   int32_t speed = 100000;
   int num_of_threads[4] = {1, 2, 6, 12};
   bool iterative_visualization = true;
@@ -304,7 +326,7 @@ void test_20() {
 void test_21() {
   int_t side = 256;
 
-  maze_t maze = generate_random_maze_hillbert_lookahead(side);
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
   int32_t speed = 100;
   clock_t start_time, end_time;
 
@@ -327,7 +349,7 @@ void test_21() {
 void test_22() {
   int_t side = 512;
 
-  maze_t maze = generate_random_maze_hillbert_lookahead(side);
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
   int32_t speed = 100;
   clock_t start_time, end_time;
 
@@ -344,9 +366,508 @@ void test_22() {
   }
   free(maze.data);
 }
+#define description_23                                                         \
+  "generates a 2048x2048 maze and prints its overview and a viewport"
+void test_23() {
+  int_t side = 2048;
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
+  solver_state_t state;
+  init_solver_state(&state, maze, 1, false);
+  // pretend the upper left triangle was explored
+  for (int_t y = 0; y < side; ++y) {
+    for (int_t x = 0; x < side - y; ++x) {
+      explored_at(state.explored, x, y) = true;
+    }
+  }
+  clock_t start = clock();
+  print_maze_overview(&state, (vec2_t){80, 20});
+  print_maze_explored_viewport(
+      &state, viewport_around(maze, (vec2_t){side / 2, side / 2}, (vec2_t){40, 10}));
+  print_maze_viewport(maze, viewport_around_goal(&state, (vec2_t){40, 10}));
+  clock_t end = clock();
+  float seconds = (float)(end - start) / CLOCKS_PER_SEC;
+  printf("printed after %.4fs...\n", seconds);
+  cleanup_solver_state(&state);
+  free(maze.data);
+}
+#define description_24                                                         \
+  "solves a 4096x4096 maze and exports it to a temporary PPM file"
+void test_24() {
+  int_t side = 4096;
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
+  solver_state_t state;
+  init_solver_state(&state, maze, CPU_CORES, false);
+  run_solver(&state, 0);
+  char path[TEMP_PATH_SIZE];
+  close(open_temp_file(path, ".ppm"));
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  export_maze_image(maze, &state, path, CPU_CORES);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("exported after %.4fs...\n", seconds);
+  unlink(path);
+  cleanup_solver_state(&state);
+  free(maze.data);
+}
+#define description_25 "saves a 1024x1024 maze to a file and loads it back"
+void test_25() {
+  int_t side = 1024;
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
+  maze_file_info_t info = {MAZE_GENERATOR_HILBERT, 0};
+  char path[TEMP_PATH_SIZE];
+  close(open_temp_file(path, ".cmz"));
+  write_maze_file(maze, path, info);
+
+  maze_file_t file = map_maze_file(path);
+  bool same = verify_maze_file(file, CPU_CORES);
+  for (int_t y = 0; y < side && same; ++y)
+    for (int_t x = 0; x < side && same; ++x)
+      same = maze_file_at(file, x, y) == maze_at(maze, x, y).open_directions;
+  unmap_maze_file(&file);
+
+  maze_t loaded = load_maze_file(path, &info, CPU_CORES);
+  unlink(path);
+  for (int_t i = 0; i < side * side && same; ++i)
+    same = loaded.data[i].open_directions == maze.data[i].open_directions;
+  printf("saved and loaded maze %s\n", same ? "match" : "differ");
+  free(loaded.data);
+  free(maze.data);
+}
+
+#define description_26 "generates and solves a 8192x8192 maze with a 1MB tile cache"
+void test_26() {
+  int_t side = 8192;
+  size_t cache_bytes = 1 << 20;
+  char tiles_path[TEMP_PATH_SIZE], path[TEMP_PATH_SIZE];
+  close(open_temp_file(tiles_path, ".tiles"));
+  close(open_temp_file(path, ".cmz"));
+  tiled_maze_t maze =
+      generate_random_maze_tiled(tiles_path, side, side, 128, cache_bytes, seed);
+  printf("generated: %lu hits, %lu misses, %lu evictions\n",
+         (unsigned long)maze.hits, (unsigned long)maze.misses,
+         (unsigned long)maze.evictions);
+  tiled_solution_t solution = solve_tiled_maze(&maze);
+  printf("solved: %s, path of %lu cells, %lu cells explored\n",
+         solution.found ? "found" : "not found",
+         (unsigned long)solution.path_length, (unsigned long)solution.explored);
+  write_tiled_maze_file(&maze, path);
+  close_tiled_maze(&maze);
+  unlink(tiles_path);
+  unlink(path);
+}
+
+#define description_27 "converts a 4096x4096 maze to packed and bitplane form and back"
+void test_27() {
+  int_t side = 4096;
+  maze_t maze = generate_random_maze_hillbert_lookahead(side, CPU_CORES, seed);
+  packed_maze_t packed = maze_to_packed(maze, CPU_CORES);
+  bitplane_maze_t bitplanes = maze_to_bitplanes(maze, CPU_CORES);
+  maze_t from_packed = packed_to_maze(packed, CPU_CORES);
+  maze_t from_bitplanes = bitplanes_to_maze(bitplanes, CPU_CORES);
+
+  bool same = true;
+  for (int_t y = 0; y < side && same; ++y)
+    for (int_t x = 0; x < side && same; ++x) {
+      direction_t open = maze_at(maze, x, y).open_directions;
+      same = packed_maze_open_directions(packed, x, y) == open &&
+             bitplane_maze_open_directions(bitplanes, x, y) == open &&
+             maze_at(from_packed, x, y).open_directions == open &&
+             maze_at(from_bitplanes, x, y).open_directions == open;
+    }
+  printf("conversions %s\n", same ? "match" : "differ");
+  free_packed_maze(&packed);
+  free_bitplane_maze(&bitplanes);
+  free(from_packed.data);
+  free(from_bitplanes.data);
+  free(maze.data);
+}
+
+#define description_28                                                         \
+  "generates a 2048x2048 maze in parallel with 1, 2, 4 and 8 workers and "     \
+  "checks they are identical"
+void test_28() {
+  int_t side = 2048;
+  uint64_t iterations = (uint64_t)side * side * 20;
+  maze_t reference =
+      generate_random_maze_MCMC_parallel(side, side, iterations, 1, seed);
+  for (uint8_t workers = 2; workers <= 8; workers *= 2) {
+    maze_t maze =
+        generate_random_maze_MCMC_parallel(side, side, iterations, workers, seed);
+    bool same = memcmp(maze.data, reference.data, (size_t)side * side) == 0;
+    printf("%d workers: %s\n", workers, same ? "identical" : "different");
+    free(maze.data);
+  }
+  free(reference.data);
+}
+
+#define description_29                                                         \
+  "generates a 1024x1024 maze with Wilson's algorithm and a 4096x4096 one "    \
+  "in parallel"
+void test_29() {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze_t maze = generate_random_maze_wilson(1024, 1024, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("1024x1024 after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  free(maze.data);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze = generate_random_maze_wilson_parallel(4096, 4096, CPU_CORES, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("4096x4096 after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  free(maze.data);
+}
+
+#define description_30                                                         \
+  "generates a 60x24 maze with gilbert lookahead and a 3000x1200 one with "    \
+  "1 and 7 workers and checks they are identical"
+void test_30() {
+  maze_t maze = generate_random_maze_gilbert_lookahead(60, 24, CPU_CORES, seed);
+  print_maze(maze);
+  free(maze.data);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze = generate_random_maze_gilbert_lookahead(3000, 1200, 1, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("3000x1200 after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  maze_t parallel = generate_random_maze_gilbert_lookahead(3000, 1200, 7, seed);
+  bool same = memcmp(maze.data, parallel.data,
+                     (size_t)3000 * 1200 * sizeof(maze_vertex_t)) == 0;
+  printf("7 workers: %s\n", same ? "identical" : "different");
+  free(parallel.data);
+  free(maze.data);
+}
+
+#define description_31                                                         \
+  "generates a 2048x2048 maze with Kruskal's algorithm with 1, 2, 4 and 8 "    \
+  "workers and checks they are identical"
+void test_31() {
+  int_t side = 2048;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze_t reference = generate_random_maze_kruskal(side, side, 1, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("1 worker after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  for (uint8_t workers = 2; workers <= 8; workers *= 2) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    maze_t maze = generate_random_maze_kruskal(side, side, workers, seed);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    bool same = memcmp(maze.data, reference.data, (size_t)side * side) == 0;
+    printf("%d workers after %.4fs: %s\n", workers,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           same ? "identical" : "different");
+    free(maze.data);
+  }
+  free(reference.data);
+}
+
+#define description_32                                                         \
+  "generates a 16384x16384 maze by recursive division and solves a "           \
+  "256x256 one"
+void test_32() {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze_t maze = generate_random_maze_division(16384, 16384, CPU_CORES, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("16384x16384 after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  free(maze.data);
+
+  maze = generate_random_maze_division(256, 256, CPU_CORES, seed);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  solve_maze(maze, CPU_CORES, false, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("solved 256x256 after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  free(maze.data);
+}
+
+#define description_33                                                         \
+  "streams a 16384x4096 maze generated with Eller's algorithm to a file, "     \
+  "verifies it and checks it against the one generated in memory"
+void test_33() {
+  int_t dim_x = 16384, dim_y = 4096;
+  char path[TEMP_PATH_SIZE];
+  int fd = open_temp_file(path, ".cmz");
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  write_maze_file_eller(fd, dim_x, dim_y, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  close(fd);
+  printf("%ux%u streamed after %.4fs...\n", dim_x, dim_y,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  maze_t maze = generate_random_maze_eller(dim_x, dim_y, seed);
+  maze_file_t file = map_maze_file(path);
+  unlink(path);
+  bool same = verify_maze_file(file, CPU_CORES);
+  for (int_t y = 0; y < dim_y && same; ++y)
+    for (int_t x = 0; x < dim_x && same; ++x)
+      same = maze_file_at(file, x, y) == maze_at(maze, x, y).open_directions;
+  unmap_maze_file(&file);
+  printf("streamed and generated maze %s\n", same ? "match" : "differ");
+  free(maze.data);
+}
+
+#define description_34                                                         \
+  "braids a 1024x1024 maze with 1 and 4 workers, counting dead ends, and "      \
+  "solves a 64x64 braided maze"
+static index_t count_dead_ends(maze_t maze) {
+  index_t dead_ends = 0;
+  for (int_t y = 0; y < maze.dimensions.y; ++y)
+    for (int_t x = 0; x < maze.dimensions.x; ++x)
+      dead_ends += __builtin_popcount(maze_at(maze, x, y).open_directions) == 1;
+  return dead_ends;
+}
+void test_34() {
+  int_t side = 1024;
+  maze_t reference = generate_random_maze_wilson(side, side, seed);
+  maze_t maze = generate_random_maze_wilson(side, side, seed);
+  index_t dead_ends = count_dead_ends(reference);
+  for (int i = 0; i <= 4; ++i) {
+    double fraction = i / 4.0;
+    memcpy(maze.data, reference.data, (size_t)side * side);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    index_t opened = braid_maze(maze, fraction, 1, seed);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    index_t left = count_dead_ends(maze);
+
+    maze_t parallel = generate_random_maze_wilson(side, side, seed);
+    braid_maze(parallel, fraction, 4, seed);
+    bool same = memcmp(maze.data, parallel.data, (size_t)side * side) == 0;
+    free(parallel.data);
+    printf("fraction %.2f: %lu walls opened, %lu of %lu dead ends left after "
+           "%.4fs, 4 workers %s\n",
+           fraction, (unsigned long)opened, (unsigned long)left,
+           (unsigned long)dead_ends,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           same ? "identical" : "different");
+  }
+  free(maze.data);
+  free(reference.data);
+
+  maze = generate_random_maze_wilson(64, 64, seed);
+  braid_maze(maze, 0.5, CPU_CORES, seed);
+  uint32_t speed = 10000;
+  bool iterative_visualization = true;
+  solve_maze(maze, CPU_CORES, iterative_visualization, speed);
+  free(maze.data);
+}
+
+#define description_35                                                         \
+  "generates 1024x1024 MCMC mazes until the walk covers 99 and 100 percent "   \
+  "of the cells and with side^3 iterations, comparing dead ends"
+void test_35() {
+  int_t side = 1024;
+  double coverages[2] = {0.99, 1.0};
+  struct timespec start, end;
+  for (int i = 0; i <= 2; ++i) {
+    uint64_t iterations = (uint64_t)side * side * side;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    maze_t maze =
+        i < 2 ? generate_random_maze_MCMC_adaptive(side, side, coverages[i],
+                                                   &iterations, seed)
+              : generate_random_maze_MCMC(side, side, iterations, seed);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    index_t dead_ends = count_dead_ends(maze);
+    printf("%s: %lu iterations after %.4fs, %.2f%% dead ends\n",
+           i == 0 ? "99% coverage" : i == 1 ? "cover time" : "side^3",
+           (unsigned long)iterations,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           100.0 * dead_ends / ((index_t)side * side));
+    free(maze.data);
+  }
+}
+
+#define description_36                                                         \
+  "generates a 512x512 maze with many origins at once with 1, 2, 4 and 8 "     \
+  "workers, and compares the passages across tile borders with the glued "     \
+  "parallel maze"
+// passages through the east walls of the columns ending a tile of side
+// tile_side, per wall, and through the other east walls
+static void border_passages(maze_t maze, int_t tile_side, double *border,
+                            double *inside) {
+  index_t open[2] = {0, 0}, walls[2] = {0, 0};
+  for (int_t y = 0; y < maze.dimensions.y; ++y)
+    for (int_t x = 0; x + 1 < maze.dimensions.x; ++x) {
+      bool on_border = (x + 1) % tile_side == 0;
+      open[on_border] += (maze_at(maze, x, y).open_directions & EAST) != 0;
+      walls[on_border]++;
+    }
+  *inside = (double)open[0] / walls[0];
+  *border = (double)open[1] / walls[1];
+}
+void test_36() {
+  int_t side = 512, tile_side = 64;
+  uint64_t iterations = (uint64_t)side * side * side;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze_t reference =
+      generate_random_maze_MCMC_multiwalker(side, side, iterations, 1, seed);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("1 worker after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  for (uint8_t workers = 2; workers <= 8; workers *= 2) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    maze_t maze = generate_random_maze_MCMC_multiwalker(side, side, iterations,
+                                                        workers, seed);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    bool same = memcmp(maze.data, reference.data, (size_t)side * side) == 0;
+    printf("%d workers after %.4fs: %s\n", workers,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           same ? "identical" : "different");
+    free(maze.data);
+  }
+
+  double border, inside;
+  border_passages(reference, tile_side, &border, &inside);
+  printf("many origins: %.3f open walls on tile borders, %.3f inside\n",
+         border, inside);
+  free(reference.data);
+  maze_t glued = generate_random_maze_MCMC_parallel(side, side, iterations,
+                                                    CPU_CORES, seed);
+  border_passages(glued, tile_side, &border, &inside);
+  printf("glued tiles: %.3f open walls on tile borders, %.3f inside\n",
+         border, inside);
+  free(glued.data);
+}
+
+#define description_37                                                         \
+  "generates a 1024x1024 maze with gilbert lookahead and its path index, and " \
+  "answers 10000 start/goal queries checked against an index found by search"
+void test_37() {
+  int_t side = 1024;
+  index_t cells = (index_t)side * side;
+  path_index_t index;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  maze_t maze = generate_random_maze_gilbert_lookahead_indexed(side, side, CPU_CORES,
+                                                               seed, &index);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("generated with its index after %.4fs...\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  path_index_t searched = path_index_from_maze(maze, cells / 2);
+  random_t random;
+  seed_random(&random, seed);
+  index_t total = 0;
+  bool same = true;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < 10000; ++i) {
+    index_t a = random_below(&random, cells), b = random_below(&random, cells);
+    index_t distance = path_index_distance(&index, a, b);
+    same = same && distance == path_index_distance(&searched, a, b);
+    total += distance;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("10000 queries after %.4fs, %.1f steps on average, %s\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+         total / 10000.0, same ? "match" : "differ");
+  free_path_index(&searched);
+  free_path_index(&index);
+  free(maze.data);
+}
+
+#define description_38                                                         \
+  "builds the LCA index of a 2048x2048 maze, answers 1000000 distance "        \
+  "queries and checks some against the path index, then opens a wall to "      \
+  "the outside of a small maze and braids the big one"
+void test_38() {
+  int_t side = 2048;
+  index_t cells = (index_t)side * side;
+  maze_t maze = generate_random_maze_wilson(side, side, seed);
+  lca_index_t index;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool tree = build_lca_index(maze, CPU_CORES, &index);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("index built after %.4fs, %s\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+         tree ? "a tree" : "not a tree");
+  if (!tree) {
+    free(maze.data);
+    return;
+  }
+
+  random_t random;
+  seed_random(&random, seed);
+  index_t total = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < 1000000; ++i)
+    total += lca_index_distance(&index, random_below(&random, cells),
+                                random_below(&random, cells));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("1000000 queries after %.4fs, %.1f steps on average\n",
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+         total / 1000000.0);
+
+  bool same = true;
+  for (int i = 0; i < 1000 && same; ++i) {
+    index_t a = random_below(&random, cells), b = random_below(&random, cells);
+    same = lca_index_distance(&index, a, b) ==
+           path_index_distance(&index.tree, a, b);
+  }
+  printf("walking up the tree: %s\n", same ? "match" : "differ");
+  free_lca_index(&index);
+
+  maze_t small = generate_random_maze_wilson(8, 8, seed);
+  maze_at(small, 7, 7).open_directions |= SOUTH;
+  tree = build_lca_index(small, CPU_CORES, &index);
+  printf("with a wall open to the outside: %s\n",
+         tree ? "a tree" : "not a tree");
+  if (tree)
+    free_lca_index(&index);
+  path_index_t outside = path_index_from_maze(small, 0);
+  free_path_index(&outside);
+  free(small.data);
+
+  braid_maze(maze, 0.1, CPU_CORES, seed);
+  tree = build_lca_index(maze, CPU_CORES, &index);
+  printf("braided: %s\n", tree ? "a tree" : "not a tree");
+  if (tree)
+    free_lca_index(&index);
+  free(maze.data);
+}
+
+#define description_39                                                         \
+  "analyzes a 16384x16384 maze, then braids it, then opens a wall to the "     \
+  "outside and analyzes it again each time"
+void test_39() {
+  int_t side = 16384;
+  maze_t maze = generate_random_maze_division(side, side, CPU_CORES, seed);
+  vec2_t start = {0, 0}, goal = {side - 1, side - 1};
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  maze_analysis_t analysis = analyze_maze(maze, start, goal, CPU_CORES);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("analyzed after %.4fs\n",
+         (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9);
+  print_maze_analysis(&analysis);
+
+  braid_maze(maze, 0.5, CPU_CORES, seed);
+  analysis = analyze_maze(maze, start, goal, CPU_CORES);
+  printf("\nbraided:\n");
+  print_maze_analysis(&analysis);
+
+  maze_at(maze, side - 1, side / 2).open_directions |= EAST;
+  analysis = analyze_maze(maze, start, goal, CPU_CORES);
+  printf("\nwith a wall open to the outside: %s\n",
+         maze_kind_name(analysis.kind));
+  free(maze.data);
+}
+
 int main(int argc, char **argv) {
   setlocale(LC_ALL, "");
   srand(time(NULL));
+  seed = getenv("MAZE_SEED") ? strtoull(getenv("MAZE_SEED"), NULL, 10) : time(NULL);
   if (argc == 1) {
     printf("\n 1. ");
     printf(description_1);
@@ -392,6 +913,40 @@ int main(int argc, char **argv) {
     printf(description_21);
     printf("\n22. ");
     printf(description_22);
+    printf("\n23. ");
+    printf(description_23);
+    printf("\n24. ");
+    printf(description_24);
+    printf("\n25. ");
+    printf(description_25);
+    printf("\n26. ");
+    printf(description_26);
+    printf("\n27. ");
+    printf(description_27);
+    printf("\n28. ");
+    printf(description_28);
+    printf("\n29. ");
+    printf(description_29);
+    printf("\n30. ");
+    printf(description_30);
+    printf("\n31. ");
+    printf(description_31);
+    printf("\n32. ");
+    printf(description_32);
+    printf("\n33. ");
+    printf(description_33);
+    printf("\n34. ");
+    printf(description_34);
+    printf("\n35. ");
+    printf(description_35);
+    printf("\n36. ");
+    printf(description_36);
+    printf("\n37. ");
+    printf(description_37);
+    printf("\n38. ");
+    printf(description_38);
+    printf("\n39. ");
+    printf(description_39);
 
     printf("\n\nexample:  ./bin/tests 1 5 6\n\n");
   }
@@ -464,6 +1019,58 @@ int main(int argc, char **argv) {
     case 22:
       test_22();
       break;
+    case 23:
+      test_23();
+      break;
+    case 24:
+      test_24();
+      break;
+    case 25:
+      test_25();
+      break;
+    case 26:
+      test_26();
+      break;
+    case 27:
+      test_27();
+      break;
+    case 28:
+      test_28();
+      break;
+    case 29:
+      test_29();
+      break;
+    case 30:
+      test_30();
+      break;
+    case 31:
+      test_31();
+      break;
+    case 32:
+      test_32();
+      break;
+    case 33:
+      test_33();
+      break;
+    case 34:
+      test_34();
+      break;
+    case 35:
+      test_35();
+      break;
+    case 36:
+      test_36();
+      break;
+    case 37:
+      test_37();
+      break;
+    case 38:
+      test_38();
+      break;
+
+    case 39:
+      test_39();
+      break;
 
     default:
       printf("No test selected, exiting...");
@@ -0,0 +1,309 @@
+#include "tiled_maze.h"
+#include "maze_file.h"
+#include "common.h"
+#include "random.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EMPTY_SLOT UINT64_MAX
+
+// the upper nibble of a cell keeps the direction back to where it was reached from
+#define PARENT_SHIFT 4
+#define OPEN_MASK 0xF
+#define SEARCH_ROOT 0xF         // parent of the search start, not a direction
+#define opposite(dir) (((dir)<<2 | (dir)>>2) & 0xF)
+
+
+
+tiled_maze_t create_tiled_maze(const char *path, int_t dim_x, int_t dim_y, int_t tile_side, size_t cache_bytes){
+    tiled_maze_t maze;
+    if(tile_side == 0 || (tile_side & (tile_side-1)))
+        PERROR("Tile side %u is not a power of two",tile_side);
+
+    maze.dimensions = (vec2_t){dim_x,dim_y};
+    maze.tile_shift = __builtin_ctz(tile_side);
+    maze.tiles = (vec2_t){(dim_x+tile_side-1)/tile_side,(dim_y+tile_side-1)/tile_side};
+    maze.tile_cells = (size_t)tile_side*tile_side;
+    uint64_t number_of_tiles = (uint64_t)maze.tiles.x*maze.tiles.y;
+
+    maze.cache_tiles = cache_bytes/(maze.tile_cells*sizeof(maze_vertex_t));
+    if(maze.cache_tiles < 4) maze.cache_tiles = 4;
+    if((uint64_t)maze.cache_tiles > number_of_tiles) maze.cache_tiles = number_of_tiles;
+
+    maze.fd = open(path,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(maze.fd < 0) PERROR("Couldn't create tiled maze file %s",path);
+    // the file starts sparse, so every cell reads as closed
+    if(ftruncate(maze.fd,number_of_tiles*maze.tile_cells*sizeof(maze_vertex_t)) != 0)
+        PERROR("Couldn't resize tiled maze file %s",path);
+
+    maze.slots = (maze_vertex_t*) malloc((size_t)maze.cache_tiles*maze.tile_cells*sizeof(maze_vertex_t));
+    maze.slot_info = (tile_slot_t*) malloc(maze.cache_tiles*sizeof(tile_slot_t));
+    maze.tile_to_slot = (int32_t*) malloc(number_of_tiles*sizeof(int32_t));
+    if(!maze.slots || !maze.slot_info || !maze.tile_to_slot)
+        PERROR("Couldn't allocate tile cache for the maze with size: %d x %d",dim_x,dim_y);
+    memset(maze.tile_to_slot,-1,number_of_tiles*sizeof(int32_t));
+
+    for(int32_t i = 0 ; i < maze.cache_tiles ; ++i)
+        maze.slot_info[i] = (tile_slot_t){EMPTY_SLOT,i-1,i+1 < maze.cache_tiles ? i+1 : -1,false};
+    maze.lru_head = 0;
+    maze.lru_tail = maze.cache_tiles-1;
+
+    maze.last_tile = EMPTY_SLOT;
+    maze.last_data = NULL;
+    maze.last_dirty = false;
+    maze.hits = maze.misses = maze.evictions = 0;
+    return maze;
+}
+
+
+
+static off_t tile_offset(tiled_maze_t *maze, uint64_t tile){
+    return (off_t)(tile*maze->tile_cells*sizeof(maze_vertex_t));
+}
+
+static void write_back(tiled_maze_t *maze, int32_t slot){
+    tile_slot_t *info = &maze->slot_info[slot];
+    if(!info->dirty) return;
+    size_t size = maze->tile_cells*sizeof(maze_vertex_t);
+    if(pwrite(maze->fd,maze->slots + slot*maze->tile_cells,size,tile_offset(maze,info->tile)) != (ssize_t)size)
+        PERROR("Couldn't write back tile %lu",(unsigned long)info->tile);
+    info->dirty = false;
+}
+
+static void read_tile(tiled_maze_t *maze, int32_t slot, uint64_t tile){
+    size_t size = maze->tile_cells*sizeof(maze_vertex_t);
+    if(pread(maze->fd,maze->slots + slot*maze->tile_cells,size,tile_offset(maze,tile)) != (ssize_t)size)
+        PERROR("Couldn't read tile %lu",(unsigned long)tile);
+}
+
+// asks the kernel to start reading the neighbouring tiles, so a walk
+// crossing into them doesn't wait for the disk
+static void prefetch_neighbours(tiled_maze_t *maze, uint64_t tile){
+    int_t tile_x = tile % maze->tiles.x, tile_y = tile / maze->tiles.x;
+    size_t size = maze->tile_cells*sizeof(maze_vertex_t);
+    if(tile_x > 0) posix_fadvise(maze->fd,tile_offset(maze,tile-1),size,POSIX_FADV_WILLNEED);
+    if(tile_x+1 < maze->tiles.x) posix_fadvise(maze->fd,tile_offset(maze,tile+1),size,POSIX_FADV_WILLNEED);
+    if(tile_y > 0) posix_fadvise(maze->fd,tile_offset(maze,tile-maze->tiles.x),size,POSIX_FADV_WILLNEED);
+    if(tile_y+1 < maze->tiles.y) posix_fadvise(maze->fd,tile_offset(maze,tile+maze->tiles.x),size,POSIX_FADV_WILLNEED);
+}
+
+static void move_to_front(tiled_maze_t *maze, int32_t slot){
+    if(maze->lru_head == slot) return;
+    tile_slot_t *info = &maze->slot_info[slot];
+    maze->slot_info[info->prev].next = info->next;
+    if(info->next >= 0) maze->slot_info[info->next].prev = info->prev;
+    else maze->lru_tail = info->prev;
+    info->prev = -1;
+    info->next = maze->lru_head;
+    maze->slot_info[maze->lru_head].prev = slot;
+    maze->lru_head = slot;
+}
+
+
+
+void tiled_maze_fault(tiled_maze_t *maze, uint64_t tile, bool write){
+    int32_t slot = maze->tile_to_slot[tile];
+    if(slot >= 0){
+        maze->hits++;
+    } else{
+        maze->misses++;
+        slot = maze->lru_tail;
+        tile_slot_t *info = &maze->slot_info[slot];
+        if(info->tile != EMPTY_SLOT){
+            write_back(maze,slot);
+            maze->tile_to_slot[info->tile] = -1;
+            maze->evictions++;
+        }
+        read_tile(maze,slot,tile);
+        info->tile = tile;
+        maze->tile_to_slot[tile] = slot;
+        prefetch_neighbours(maze,tile);
+    }
+    move_to_front(maze,slot);
+    if(write) maze->slot_info[slot].dirty = true;
+
+    maze->last_tile = tile;
+    maze->last_data = maze->slots + slot*maze->tile_cells;
+    maze->last_dirty = maze->slot_info[slot].dirty;
+}
+
+
+
+void flush_tiled_maze(tiled_maze_t *maze){
+    for(int32_t i = 0 ; i < maze->cache_tiles ; ++i)
+        if(maze->slot_info[i].tile != EMPTY_SLOT)
+            write_back(maze,i);
+    // the last tile has to be marked dirty again on its next write
+    maze->last_dirty = false;
+}
+
+
+
+void close_tiled_maze(tiled_maze_t *maze){
+    flush_tiled_maze(maze);
+    close(maze->fd);
+    free(maze->slots);
+    free(maze->slot_info);
+    free(maze->tile_to_slot);
+    maze->slots = NULL;
+    maze->slot_info = NULL;
+    maze->tile_to_slot = NULL;
+}
+
+
+
+void write_tiled_maze_file(tiled_maze_t *maze, const char *path){
+    int fd = open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd < 0) PERROR("Couldn't open %s to write the maze",path);
+    maze_file_writer_t writer;
+    begin_maze_file(&writer,fd,maze->dimensions.x,maze->dimensions.y,(maze_file_info_t){MAZE_GENERATOR_UNKNOWN,0});
+
+    // a band of tile rows is packed tile by tile, so each tile is read once
+    int_t tile_side = 1u << maze->tile_shift;
+    size_t row_bytes = writer.header.row_bytes;
+    uint8_t *band = (uint8_t*) calloc((size_t)tile_side*row_bytes,1);
+    if(!band) PERROR("Couldn't allocate band to write the maze");
+
+    for(int_t y0 = 0 ; y0 < maze->dimensions.y ; y0 += tile_side){
+        int_t rows = maze->dimensions.y - y0 < tile_side ? maze->dimensions.y - y0 : tile_side;
+        for(int_t x0 = 0 ; x0 < maze->dimensions.x ; x0 += tile_side){
+            int_t columns = maze->dimensions.x - x0 < tile_side ? maze->dimensions.x - x0 : tile_side;
+            maze_vertex_t *tile = tiled_maze_cell(maze,x0,y0,false);
+            for(int_t r = 0 ; r < rows ; ++r){
+                uint8_t *packed = band + r*row_bytes;
+                for(int_t c = 0 ; c < columns ; ++c){
+                    int_t x = x0 + c;
+                    uint8_t cell = tile[((size_t)r << maze->tile_shift) + c].open_directions & OPEN_MASK;
+                    if(x & 1) packed[x>>1] = (packed[x>>1] & 0x0F) | (cell << 4);
+                    else packed[x>>1] = (packed[x>>1] & 0xF0) | cell;
+                }
+            }
+        }
+        for(int_t r = 0 ; r < rows ; ++r)
+            write_maze_file_packed_row(&writer,band + r*row_bytes);
+    }
+    free(band);
+    end_maze_file(&writer);
+    close(fd);
+}
+
+
+
+static vec2_t step(vec2_t position, direction_t direction){
+    switch(direction){
+        case NORTH: position.y--; break;
+        case SOUTH: position.y++; break;
+        case EAST: position.x++; break;
+        case WEST: position.x--; break;
+    }
+    return position;
+}
+
+// directions that don't leave the maze
+static direction_t inside_directions(tiled_maze_t *maze, vec2_t position){
+    direction_t directions = 0;
+    if(position.y > 0) directions |= NORTH;
+    if(position.x+1 < maze->dimensions.x) directions |= EAST;
+    if(position.y+1 < maze->dimensions.y) directions |= SOUTH;
+    if(position.x > 0) directions |= WEST;
+    return directions;
+}
+
+
+
+tiled_maze_t generate_random_maze_tiled(const char *path, int_t dim_x, int_t dim_y, int_t tile_side, size_t cache_bytes, uint64_t seed){
+    tiled_maze_t maze = create_tiled_maze(path,dim_x,dim_y,tile_side,cache_bytes);
+    random_t random;
+    seed_random(&random,seed);
+    vec2_t current = {0,0};
+
+    // a cell was visited when it has an open direction; the start gets
+    // one as soon as the first passage is carved
+    while(true){
+        direction_t candidates = inside_directions(&maze,current);
+        direction_t available = 0;
+        for(direction_t direction = NORTH; direction <= WEST; direction<<=1){
+            if(!(candidates & direction)) continue;
+            vec2_t next = step(current,direction);
+            if(!(tiled_maze_get(maze,next.x,next.y).open_directions & OPEN_MASK))
+                available |= direction;
+        }
+
+        if(available){
+            direction_t direction = fast_random_direction(&random,available);
+            tiled_maze_at(maze,current.x,current.y).open_directions |= direction;
+            current = step(current,direction);
+            tiled_maze_at(maze,current.x,current.y).open_directions |= opposite(direction) | (opposite(direction) << PARENT_SHIFT);
+        } else{
+            // nothing left around this cell, go back and forget the way back
+            maze_vertex_t *cell = &tiled_maze_at(maze,current.x,current.y);
+            direction_t parent = cell->open_directions >> PARENT_SHIFT;
+            if(!parent) break;
+            cell->open_directions &= OPEN_MASK;
+            current = step(current,parent);
+        }
+    }
+    flush_tiled_maze(&maze);
+    return maze;
+}
+
+
+
+// clears the search marks tile by tile
+static void clear_marks(tiled_maze_t *maze){
+    int_t tile_side = 1u << maze->tile_shift;
+    for(int_t y = 0 ; y < maze->dimensions.y ; y += tile_side)
+        for(int_t x = 0 ; x < maze->dimensions.x ; x += tile_side){
+            maze_vertex_t *tile = tiled_maze_cell(maze,x,y,true);
+            for(size_t i = 0 ; i < maze->tile_cells ; ++i)
+                tile[i].open_directions &= OPEN_MASK;
+        }
+}
+
+
+
+tiled_solution_t solve_tiled_maze(tiled_maze_t *maze){
+    tiled_solution_t solution = {false,0,1};
+    vec2_t goal = {maze->dimensions.x-1,maze->dimensions.y-1};
+    vec2_t current = {0,0};
+    tiled_maze_at(*maze,0,0).open_directions |= SEARCH_ROOT << PARENT_SHIFT;
+    direction_t next_try = NORTH;
+
+    while(!(current.x == goal.x && current.y == goal.y)){
+        direction_t cell = tiled_maze_get(*maze,current.x,current.y).open_directions;
+        direction_t open = cell & inside_directions(maze,current);
+        direction_t chosen = 0;
+        for(direction_t direction = next_try; direction <= WEST && !chosen; direction<<=1){
+            if(!(open & direction)) continue;
+            vec2_t next = step(current,direction);
+            if(!(tiled_maze_get(*maze,next.x,next.y).open_directions >> PARENT_SHIFT))
+                chosen = direction;
+        }
+
+        if(chosen){
+            current = step(current,chosen);
+            tiled_maze_at(*maze,current.x,current.y).open_directions |= opposite(chosen) << PARENT_SHIFT;
+            solution.explored++;
+            next_try = NORTH;
+        } else{
+            // dead end, go back and continue with the parent's next direction
+            direction_t parent = cell >> PARENT_SHIFT;
+            if(parent == SEARCH_ROOT) break;
+            current = step(current,parent);
+            next_try = opposite(parent) << 1;
+        }
+    }
+
+    if(current.x == goal.x && current.y == goal.y){
+        solution.found = true;
+        solution.path_length = 1;
+        for(direction_t parent; (parent = tiled_maze_get(*maze,current.x,current.y).open_directions >> PARENT_SHIFT) != SEARCH_ROOT;){
+            current = step(current,parent);
+            solution.path_length++;
+        }
+    }
+    clear_marks(maze);
+    flush_tiled_maze(maze);
+    return solution;
+}
@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include "topology.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_NUMA_NODES 1024
+#define FIRST_TOUCH_MIN_BYTES ((size_t)16<<20)
+
+static topology_t topology;
+static enum pinning_policy pinning_policy;
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+
+
+// parses a sysfs cpulist like "0-3,8-11" into a cpu set
+static void parse_cpulist(const char *list, cpu_set_t *set){
+    CPU_ZERO(set);
+    while(*list){
+        char *end;
+        long first = strtol(list,&end,10);
+        if(end == list) break;
+        long last = first;
+        if(*end == '-') last = strtol(end+1,&end,10);
+        for(long cpu = first ; cpu <= last && cpu < CPU_SETSIZE ; ++cpu)
+            CPU_SET(cpu,set);
+        list = (*end == ',') ? end+1 : end;
+        if(*list == '\n') break;
+    }
+}
+
+static void detect_topology(void){
+    cpu_set_t allowed;
+    if(sched_getaffinity(0,sizeof(allowed),&allowed) != 0){
+        CPU_ZERO(&allowed);
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for(long cpu = 0 ; cpu < online && cpu < CPU_SETSIZE ; ++cpu)
+            CPU_SET(cpu,&allowed);
+    }
+
+    int count = CPU_COUNT(&allowed);
+    if(count < 1) count = 1;
+    topology.cpus = (int*) malloc(count*sizeof(int));
+    topology.node_of_cpu = (int*) malloc(count*sizeof(int));
+    if(!topology.cpus || !topology.node_of_cpu) PERROR("Couldn't allocate the cpu topology");
+    topology.number_of_cpus = 0;
+    topology.number_of_nodes = 0;
+
+    // cpus grouped by node, in node order
+    for(int node = 0 ; node < MAX_NUMA_NODES ; ++node){
+        char path[64], list[4096];
+        snprintf(path,sizeof(path),"/sys/devices/system/node/node%d/cpulist",node);
+        FILE *file = fopen(path,"r");
+        if(!file) continue;
+        bool read = fgets(list,sizeof(list),file) != NULL;
+        fclose(file);
+        if(!read) continue;
+
+        cpu_set_t node_cpus;
+        parse_cpulist(list,&node_cpus);
+        CPU_AND(&node_cpus,&node_cpus,&allowed);
+        if(CPU_COUNT(&node_cpus) == 0) continue;
+        for(int cpu = 0 ; cpu < CPU_SETSIZE && topology.number_of_cpus < count ; ++cpu){
+            if(!CPU_ISSET(cpu,&node_cpus)) continue;
+            topology.cpus[topology.number_of_cpus] = cpu;
+            topology.node_of_cpu[topology.number_of_cpus] = topology.number_of_nodes;
+            topology.number_of_cpus++;
+            CPU_CLR(cpu,&allowed);
+        }
+        topology.number_of_nodes++;
+    }
+
+    // cpus sysfs didn't place (or no sysfs at all) go on one more node
+    if(CPU_COUNT(&allowed) > 0 || topology.number_of_cpus == 0){
+        for(int cpu = 0 ; cpu < CPU_SETSIZE && topology.number_of_cpus < count ; ++cpu){
+            if(!CPU_ISSET(cpu,&allowed)) continue;
+            topology.cpus[topology.number_of_cpus] = cpu;
+            topology.node_of_cpu[topology.number_of_cpus] = topology.number_of_nodes;
+            topology.number_of_cpus++;
+        }
+        if(topology.number_of_cpus == 0){
+            topology.cpus[0] = 0;
+            topology.node_of_cpu[0] = 0;
+            topology.number_of_cpus = 1;
+        }
+        topology.number_of_nodes++;
+    }
+
+    const char *policy = getenv("MAZE_PINNING");
+    pinning_policy = PIN_NONE;
+    if(policy && strcmp(policy,"compact") == 0) pinning_policy = PIN_COMPACT;
+    if(policy && strcmp(policy,"scatter") == 0) pinning_policy = PIN_SCATTER;
+}
+
+
+
+const topology_t *get_topology(void){
+    pthread_once(&topology_once,detect_topology);
+    return &topology;
+}
+
+uint8_t available_cores(void){
+    int cpus = get_topology()->number_of_cpus;
+    return cpus > UINT8_MAX ? UINT8_MAX : cpus;
+}
+
+enum pinning_policy get_pinning_policy(void){
+    get_topology();
+    return pinning_policy;
+}
+
+void set_pinning_policy(enum pinning_policy policy){
+    get_topology();
+    pinning_policy = policy;
+}
+
+
+
+int cpu_for_worker(enum pinning_policy policy, uint8_t worker_id, uint8_t workers){
+    const topology_t *topo = get_topology();
+    switch(policy){
+        case PIN_COMPACT:
+            return topo->cpus[worker_id % topo->number_of_cpus];
+        case PIN_SCATTER: {
+            // the (worker_id / nodes)-th cpu of node worker_id % nodes
+            int node = worker_id % topo->number_of_nodes;
+            int rank = worker_id / topo->number_of_nodes;
+            int first = 0, size = 0;
+            for(int i = 0 ; i < topo->number_of_cpus ; ++i){
+                if(topo->node_of_cpu[i] != node) continue;
+                if(size == 0) first = i;
+                size++;
+            }
+            return topo->cpus[first + rank % size];
+        }
+        default:
+            return -1;
+    }
+}
+
+void pin_worker(uint8_t worker_id, uint8_t workers){
+    int cpu = cpu_for_worker(get_pinning_policy(),worker_id,workers);
+    if(cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu,&set);
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+}
+
+
+
+typedef struct {
+    void (*band)(uint64_t first, uint64_t last, void *arg);
+    void *arg;
+    uint64_t count;
+    uint8_t worker_id, workers;
+} _pinned_band_args_t;
+static void * _pinned_band_thread(void *void_args){
+    _pinned_band_args_t *args = (_pinned_band_args_t*) void_args;
+    pin_worker(args->worker_id,args->workers);
+    args->band(args->count*args->worker_id/args->workers,args->count*(args->worker_id+1)/args->workers,args->arg);
+    return NULL;
+}
+
+void run_pinned_bands(uint8_t workers, uint64_t count, void (*band)(uint64_t first, uint64_t last, void *arg),
+                      void *arg){
+    if(workers < 1) workers = 1;
+    pthread_t tid[UINT8_MAX];
+    _pinned_band_args_t args[UINT8_MAX];
+    bool started[UINT8_MAX];
+    for(uint8_t i = 0 ; i < workers ; ++i){
+        args[i] = (_pinned_band_args_t){band,arg,count,i,workers};
+        started[i] = pthread_create(&tid[i],NULL,_pinned_band_thread,(void*)&args[i]) == 0;
+        // out of threads the caller does the band, where it runs
+        if(!started[i]) band(count*i/workers,count*(i+1)/workers,arg);
+    }
+    for(uint8_t i = 0 ; i < workers ; ++i)
+        if(started[i]) pthread_join(tid[i],NULL);
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t bytes, page;
+} _first_touch_t;
+static void touch_pages(uint64_t first, uint64_t last, void *arg){
+    _first_touch_t *touch = (_first_touch_t*) arg;
+    size_t begin = first*touch->page, end = last*touch->page < touch->bytes ? last*touch->page : touch->bytes;
+    if(begin < end) memset(touch->data + begin,0,end - begin);
+}
+
+void first_touch(void *data, size_t bytes, uint8_t workers){
+    // unpinned threads run wherever the scheduler puts them, and so would
+    // their pages: then the memory is left to the node of the caller
+    if(workers <= 1 || bytes < FIRST_TOUCH_MIN_BYTES || get_pinning_policy() == PIN_NONE){
+        memset(data,0,bytes);
+        return;
+    }
+    // bands start on page boundaries so no page is shared by two workers,
+    // huge ones when the memory may be backed by them
+    _first_touch_t touch = {(uint8_t*)data,bytes,(size_t)sysconf(_SC_PAGESIZE)};
+    if((uintptr_t)data % HUGE_PAGE_SIZE == 0) touch.page = HUGE_PAGE_SIZE;
+    run_pinned_bands(workers,(bytes + touch.page-1)/touch.page,touch_pages,&touch);
+}
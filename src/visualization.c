@@ -2,41 +2,77 @@
 #include "special_characters.h"
 #include <unistd.h>
 #include <wchar.h>
+#include <string.h>
+#include <sys/ioctl.h>
 
+static void write_all(int fd, const char *bytes, size_t count);
+
+
+// Workers are the only writers of their own slot: the sequence is odd while
+// the slot is being written, so readers retry instead of taking a lock
+static void publish_worker_position(worker_position_t *slot, vec2_t position, bool is_active) {
+    unsigned sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->x, position.x, memory_order_relaxed);
+    atomic_store_explicit(&slot->y, position.y, memory_order_relaxed);
+    atomic_store_explicit(&slot->is_active, is_active, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+}
 
 // Update worker visualization state (marks worker as active at given position)
 void mark_worker_active_at_position(solver_state_t *state, uint8_t worker_id, vec2_t position) {
-    pthread_mutex_lock(&state->viz_mutex);
-    state->worker_positions[worker_id].position = position;
-    state->worker_positions[worker_id].is_active = true;
-    pthread_mutex_unlock(&state->viz_mutex);
+    publish_worker_position(&state->worker_positions[worker_id], position, true);
 }
 
 // Mark worker as inactive in visualization
 void mark_worker_inactive(solver_state_t *state, uint8_t worker_id) {
-    pthread_mutex_lock(&state->viz_mutex);
-    state->worker_positions[worker_id].is_active = false;
-    pthread_mutex_unlock(&state->viz_mutex);
+    worker_position_t *slot = &state->worker_positions[worker_id];
+    vec2_t position = {
+        atomic_load_explicit(&slot->x, memory_order_relaxed),
+        atomic_load_explicit(&slot->y, memory_order_relaxed)
+    };
+    publish_worker_position(slot, position, false);
 }
 
 // Update worker position (keeping active state)
 void update_worker_position(solver_state_t *state, uint8_t worker_id, vec2_t position) {
-    pthread_mutex_lock(&state->viz_mutex);
-    state->worker_positions[worker_id].position = position;
-    pthread_mutex_unlock(&state->viz_mutex);
+    worker_position_t *slot = &state->worker_positions[worker_id];
+    publish_worker_position(slot, position, atomic_load_explicit(&slot->is_active, memory_order_relaxed));
+}
+
+bool read_worker_position(solver_state_t *state, uint8_t worker_id, vec2_t *position) {
+    worker_position_t *slot = &state->worker_positions[worker_id];
+    unsigned before, after;
+    bool is_active;
+    do {
+        before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        position->x = atomic_load_explicit(&slot->x, memory_order_relaxed);
+        position->y = atomic_load_explicit(&slot->y, memory_order_relaxed);
+        is_active = atomic_load_explicit(&slot->is_active, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    } while (before != after || (before & 1));
+    return is_active;
 }
 
 void print_maze_explored(solver_state_t *state) {
+    print_maze_explored_viewport(state, full_viewport(state->maze));
+}
+
+void print_maze_explored_viewport(solver_state_t *state, viewport_t view) {
     maze_t maze = state->maze;
     exploration_map_t *exp = &state->explored;
+    int_t end_x = view.origin.x + view.size.x;
+    int_t end_y = view.origin.y + view.size.y;
     
-    for(int y = 0; y < maze.dimensions.y; y++) {
-        for(int x = 0; x < maze.dimensions.x; x++) {
+    for(int_t y = view.origin.y; y < end_y; y++) {
+        for(int_t x = view.origin.x; x < end_x; x++) {
             maze_vertex_t vertex = maze_at(maze, x, y);
             spchar_t ch = get_box_char(vertex.open_directions);
             
             // Print horizontal connector if not first column
-            if(x > 0) {
+            if(x > view.origin.x) {
                 spchar_t middle_ch;
                 if((maze_at(maze, x-1, y).open_directions & EAST) && 
                    (maze_at(maze, x, y).open_directions & WEST)) {
@@ -71,36 +107,77 @@ void print_maze_explored(solver_state_t *state) {
     }
 }
 
-// Print maze with solution path highlighted
-void print_maze_with_solution(solver_state_t *state) {
-    maze_t maze = state->maze;
+// Traces the solution back from the goal, calling visit on every cell of
+// the path (goal first, start last). Returns the path length in cells
+static uint64_t trace_solution(solver_state_t *state, void (*visit)(vec2_t, void*), void *context) {
     exploration_map_t *exp = &state->explored;
-    
-    // Build solution path by tracing back from goal to start
-    bool *is_on_path = (bool*) calloc(maze.true_dimensions.x * maze.true_dimensions.y, sizeof(bool));
-    
-    // Trace back from goal to start
+    uint64_t length = 0;
     vec2_t current = state->goal;
     while(!(current.x == 0 && current.y == 0)) {
-        int_t idx = exp->start + current.x + current.y * exp->true_dimensions.x;
-        is_on_path[idx] = true;
+        if(visit) visit(current, context);
+        length++;
         
-        direction_t came_from = exp->explored_from[idx];
+        direction_t came_from = exp->explored_from[exp->start + current.x + (size_t)current.y * exp->true_dimensions.x];
         if(came_from == 0) break; // Shouldn't happen if solution exists
         
         // Move to previous cell
         current = move_direction(current, came_from);
     }
     // Mark start
-    is_on_path[exp->start] = true;
+    if(visit) visit((vec2_t){0, 0}, context);
+    return length + 1;
+}
+
+typedef struct {
+    solver_state_t *state;
+    uint64_t visited;
+} path_tracer_t;
+
+static void mark_solution_cell(vec2_t cell, void *context) {
+    path_tracer_t *tracer = (path_tracer_t*) context;
+    solution_path_t *path = &tracer->state->solution_path;
+    index_t i = cell.x + (index_t)cell.y * tracer->state->maze.dimensions.x;
+    path->cells[i / 8] |= (uint8_t)(1 << (i % 8));
+    if(tracer->visited++ == path->length / 2) path->middle = cell;
+}
+
+solution_path_t *traced_solution(solver_state_t *state) {
+    solution_path_t *path = &state->solution_path;
+    if(path->cells) return path;
+    
+    index_t cells = (index_t)state->maze.dimensions.x * state->maze.dimensions.y;
+    path->cells = (uint8_t*) alloc_cells((cells + 7) / 8, sizeof(uint8_t));
+    if(!path->cells) {
+        PERROR("Couldn't allocate solution path for maze with size: %d x %d",
+               state->maze.dimensions.x, state->maze.dimensions.y);
+    }
+    path->middle = state->goal;
+    path->length = trace_solution(state, NULL, NULL);
+    path_tracer_t tracer = {state, 0};
+    trace_solution(state, mark_solution_cell, &tracer);
+    return path;
+}
+
+
+// Print maze with solution path highlighted
+void print_maze_with_solution(solver_state_t *state) {
+    print_maze_with_solution_viewport(state, full_viewport(state->maze));
+}
+
+void print_maze_with_solution_viewport(solver_state_t *state, viewport_t view) {
+    maze_t maze = state->maze;
+    solution_path_t *path = traced_solution(state);
+#define on_path_at(_x, _y) on_solution_at(path, maze, _x, _y)
     
-    for(int y = 0; y < maze.dimensions.y; y++) {
-        for(int x = 0; x < maze.dimensions.x; x++) {
+    int_t end_x = view.origin.x + view.size.x;
+    int_t end_y = view.origin.y + view.size.y;
+    for(int_t y = view.origin.y; y < end_y; y++) {
+        for(int_t x = view.origin.x; x < end_x; x++) {
             maze_vertex_t vertex = maze_at(maze, x, y);
             spchar_t ch = get_box_char(vertex.open_directions);
             
             // Print horizontal connector if not first column
-            if(x > 0) {
+            if(x > view.origin.x) {
                 spchar_t middle_ch;
                 if((maze_at(maze, x-1, y).open_directions & EAST) && 
                    (maze_at(maze, x, y).open_directions & WEST)) {
@@ -110,9 +187,7 @@ void print_maze_with_solution(solver_state_t *state) {
                 }
                 
                 // Highlight if on solution path
-                int_t idx = exp->start + x + y * exp->true_dimensions.x;
-                int_t idx_left = exp->start + (x-1) + y * exp->true_dimensions.x;
-                bool on_path = is_on_path[idx] || is_on_path[idx_left];
+                bool on_path = on_path_at(x, y) || on_path_at(x-1, y);
                 
                 if(on_path) wprintf(L"\033[33m\033[1m");  // Yellow + bold
                 print_spchar(middle_ch);
@@ -120,8 +195,7 @@ void print_maze_with_solution(solver_state_t *state) {
             }
             
             // Check if on solution path
-            int_t idx = exp->start + x + y * exp->true_dimensions.x;
-            bool on_path = is_on_path[idx];
+            bool on_path = on_path_at(x, y);
             
             // Mark start and goal specially
             if(x == 0 && y == 0) {
@@ -137,111 +211,436 @@ void print_maze_with_solution(solver_state_t *state) {
         }
         print_spchar(L'\n');
     }
-    
-    free(is_on_path);
+#undef on_path_at
 }
 
-// Print maze with live worker positions (for animation)
-void print_maze_animated(solver_state_t *state) {
+// ==============================================================================
+// VIEWPORTS AND OVERVIEW
+// ==============================================================================
+
+vec2_t terminal_size(void) {
+    struct winsize window;
+    if (!isatty(STDOUT_FILENO) || ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) != 0 || window.ws_col == 0) {
+        return (vec2_t){0, 0};
+    }
+    return (vec2_t){window.ws_col, window.ws_row};
+}
+
+vec2_t viewport_size_for_terminal(vec2_t terminal) {
+    // every cell but the first takes two columns (connector + cell),
+    // leave a few lines for the messages around the maze
+    int_t lines = terminal.y > 8 ? terminal.y - 8 : 1;
+    return (vec2_t){(terminal.x + 1) / 2, lines};
+}
+
+viewport_t viewport_around_goal(solver_state_t *state, vec2_t size) {
+    return viewport_around(state->maze, state->goal, size);
+}
+
+viewport_t viewport_around_worker(solver_state_t *state, uint8_t worker_id, vec2_t size) {
+    vec2_t position;
+    read_worker_position(state, worker_id, &position);
+    return viewport_around(state->maze, position, size);
+}
+
+viewport_t viewport_around_solution(solver_state_t *state, vec2_t size) {
+    // centre on the middle cell of the solution path
+    return viewport_around(state->maze, traced_solution(state)->middle, size);
+}
+
+// Braille glyphs pack 2x4 dots, dot (x, y) is bit braille_dot_bits[y][x]
+static const uint8_t braille_dot_bits[4][2] = {
+    {0x01, 0x08},
+    {0x02, 0x10},
+    {0x04, 0x20},
+    {0x40, 0x80},
+};
+#define BRAILLE_BASE 0x2800
+
+// Cells sampled per side of the block of cells behind each dot
+#define OVERVIEW_SAMPLES 4
+
+// Overview glyph flags
+#define GLYPH_PATH  1
+#define GLYPH_START 2
+#define GLYPH_GOAL  4
+
+typedef struct {
+    vec2_t glyphs;          // glyphs per row and column
+    vec2_t dots;            // dots per row and column
+    uint8_t *flags;         // GLYPH_* per glyph
+} overview_t;
+
+static vec2_t overview_dot_of(overview_t *overview, maze_t maze, vec2_t cell) {
+    return (vec2_t){
+        (int_t)((uint64_t)cell.x * overview->dots.x / maze.dimensions.x),
+        (int_t)((uint64_t)cell.y * overview->dots.y / maze.dimensions.y)
+    };
+}
+
+static void mark_path_in_overview(vec2_t cell, void *context) {
+    overview_t *overview = (overview_t*) ((void**)context)[0];
+    maze_t *maze = (maze_t*) ((void**)context)[1];
+    vec2_t dot = overview_dot_of(overview, *maze, cell);
+    overview->flags[dot.x / 2 + (size_t)(dot.y / 4) * overview->glyphs.x] |= GLYPH_PATH;
+}
+
+void print_maze_overview(solver_state_t *state, vec2_t size) {
     maze_t maze = state->maze;
-    exploration_map_t *exp = &state->explored;
+    overview_t overview;
     
-    // Worker background color codes (different bright backgrounds for each worker)
-    const wchar_t* worker_bg_colors[] = {
-        L"\033[105m",  // Bright magenta background
-        L"\033[106m",  // Bright cyan background
-        L"\033[103m",  // Bright yellow background
-        L"\033[102m",  // Bright green background
-        L"\033[104m",  // Bright blue background
-        L"\033[101m",  // Bright red background
-        L"\033[45m",   // Magenta background
-        L"\033[46m",   // Cyan background
-    };
-    int num_colors = 8;
+    // never use more dots than there are cells
+    overview.glyphs.x = size.x > 0 ? size.x : 1;
+    overview.glyphs.y = size.y > 0 ? size.y : 1;
+    if (overview.glyphs.x * 2 > maze.dimensions.x) overview.glyphs.x = (maze.dimensions.x + 1) / 2;
+    if (overview.glyphs.y * 4 > maze.dimensions.y) overview.glyphs.y = (maze.dimensions.y + 3) / 4;
+    overview.dots = (vec2_t){overview.glyphs.x * 2, overview.glyphs.y * 4};
+    overview.flags = (uint8_t*) calloc((size_t)overview.glyphs.x * overview.glyphs.y, sizeof(uint8_t));
+    if (!overview.flags) {
+        PERROR("Couldn't allocate overview with size: %d x %d", overview.glyphs.x, overview.glyphs.y);
+    }
     
-    for(int y = 0; y < maze.dimensions.y; y++) {
-        for(int x = 0; x < maze.dimensions.x; x++) {
-            maze_vertex_t vertex = maze_at(maze, x, y);
-            spchar_t ch = get_box_char(vertex.open_directions);
-            
-            // Check if any worker is at this position
-            int worker_here = -1;
-            pthread_mutex_lock(&state->viz_mutex);
-            for (uint8_t w = 0; w < state->num_workers; w++) {
-                if (state->worker_positions[w].is_active &&
-                    state->worker_positions[w].position.x == x &&
-                    state->worker_positions[w].position.y == y) {
-                    worker_here = w;
-                    break;
-                }
-            }
-            pthread_mutex_unlock(&state->viz_mutex);
-            
-            // Print horizontal connector if not first column
-            if(x > 0) {
-                spchar_t middle_ch;
-                if((maze_at(maze, x-1, y).open_directions & EAST) && 
-                   (maze_at(maze, x, y).open_directions & WEST)) {
-                    middle_ch = get_box_char(EAST|WEST);
-                } else {
-                    middle_ch = get_box_char(0);
-                }
-                
-                // Check if worker is on left cell (for coloring the connector)
-                int worker_left = -1;
-                pthread_mutex_lock(&state->viz_mutex);
-                for (uint8_t w = 0; w < state->num_workers; w++) {
-                    if (state->worker_positions[w].is_active &&
-                        state->worker_positions[w].position.x == x-1 &&
-                        state->worker_positions[w].position.y == y) {
-                        worker_left = w;
-                        break;
+    if (state->solution_found) {
+        void *context[2] = {&overview, &maze};
+        trace_solution(state, mark_path_in_overview, context);
+    }
+    vec2_t start_dot = overview_dot_of(&overview, maze, (vec2_t){0, 0});
+    vec2_t goal_dot = overview_dot_of(&overview, maze, state->goal);
+    overview.flags[start_dot.x / 2 + (size_t)(start_dot.y / 4) * overview.glyphs.x] |= GLYPH_START;
+    overview.flags[goal_dot.x / 2 + (size_t)(goal_dot.y / 4) * overview.glyphs.x] |= GLYPH_GOAL;
+    
+    // one line of glyphs at a time: style + glyph + reset per character at most
+    size_t line_capacity = (size_t)overview.glyphs.x * 24 + 2;
+    char *line = (char*) malloc(line_capacity);
+    if (!line) PERROR("Couldn't allocate overview line");
+    
+    fflush(stdout);
+    for (int_t gy = 0; gy < overview.glyphs.y; gy++) {
+        size_t length = 0;
+        for (int_t gx = 0; gx < overview.glyphs.x; gx++) {
+            uint8_t bits = 0;
+            for (int_t dy = 0; dy < 4; dy++) {
+                for (int_t dx = 0; dx < 2; dx++) {
+                    // block of cells behind this dot, sampled on a fixed grid
+                    // so the cost doesn't grow with the maze
+                    int_t dot_x = gx * 2 + dx, dot_y = gy * 4 + dy;
+                    int_t x0 = (int_t)((uint64_t)dot_x * maze.dimensions.x / overview.dots.x);
+                    int_t x1 = (int_t)((uint64_t)(dot_x + 1) * maze.dimensions.x / overview.dots.x);
+                    int_t y0 = (int_t)((uint64_t)dot_y * maze.dimensions.y / overview.dots.y);
+                    int_t y1 = (int_t)((uint64_t)(dot_y + 1) * maze.dimensions.y / overview.dots.y);
+                    if (x1 <= x0 || y1 <= y0) continue;
+                    
+                    int samples = 0, explored = 0;
+                    for (int sy = 0; sy < OVERVIEW_SAMPLES; sy++) {
+                        int_t y = y0 + (int_t)((uint64_t)(y1 - y0) * sy / OVERVIEW_SAMPLES);
+                        for (int sx = 0; sx < OVERVIEW_SAMPLES; sx++) {
+                            int_t x = x0 + (int_t)((uint64_t)(x1 - x0) * sx / OVERVIEW_SAMPLES);
+                            explored += explored_at(state->explored, x, y);
+                            samples++;
+                        }
                     }
+                    if (explored * 2 >= samples) bits |= braille_dot_bits[dy][dx];
                 }
-                pthread_mutex_unlock(&state->viz_mutex);
-                
-                // Color connector based on worker presence
-                if(worker_here >= 0 || worker_left >= 0) {
-                    int worker_id = (worker_here >= 0) ? worker_here : worker_left;
-                    wprintf(L"%ls\033[1m", worker_bg_colors[worker_id % num_colors]);
-                } else {
-                    // Color if explored
-                    bool explored = explored_at(*exp, x, y) || explored_at(*exp, x-1, y);
-                    if(explored) wprintf(L"\033[2m\033[36m");  // Dim cyan for explored
-                }
-                print_spchar(middle_ch);
-                wprintf(L"\033[0m");
             }
             
-            // Color the cell
-            bool is_explored = explored_at(*exp, x, y);
+            uint8_t flags = overview.flags[gx + (size_t)gy * overview.glyphs.x];
+            const char *style = NULL;
+            if (flags & GLYPH_START)      style = "\033[42m\033[1m";  // Green background + bold
+            else if (flags & GLYPH_GOAL)  style = "\033[41m\033[1m";  // Red background + bold
+            else if (flags & GLYPH_PATH)  style = "\033[33m\033[1m";  // Yellow + bold
+            else if (bits)                style = "\033[36m";         // Cyan
             
-            if(x == 0 && y == 0) {
-                wprintf(L"\033[42m\033[1m\033[30m");  // Green background + bold + black text (start)
-            } else if(x == state->goal.x && y == state->goal.y) {
-                wprintf(L"\033[41m\033[1m\033[97m");  // Red background + bold + white text (goal)
-            } else if(worker_here >= 0) {
-                wprintf(L"%ls\033[1m\033[30m", worker_bg_colors[worker_here % num_colors]);  // Worker background + bold + black text
-            } else if(is_explored) {
-                wprintf(L"\033[2m\033[36m");  // Dim cyan for explored
+            if (style) {
+                memcpy(line + length, style, strlen(style));
+                length += strlen(style);
+            }
+            length += spchar_to_utf8(BRAILLE_BASE + bits, line + length);
+            if (style) {
+                memcpy(line + length, "\033[0m", 4);
+                length += 4;
             }
+        }
+        line[length++] = '\n';
+        write_all(STDOUT_FILENO, line, length);
+    }
+    
+    free(line);
+    free(overview.flags);
+}
+
+// Lines taken by the header printed above the animated maze
+#define HEADER_LINES 6
+
+// Cell states tracked between frames
+#define CELL_UNEXPLORED 0
+#define CELL_EXPLORED   1
+#define CELL_WORKER     2   // CELL_WORKER + color of the worker
+#define CELL_NOT_DRAWN  0xFF
+
+// SGR styles, indexed by the style ids below
+enum {
+    STYLE_PLAIN = 0,
+    STYLE_EXPLORED,
+    STYLE_START,
+    STYLE_GOAL,
+    STYLE_WORKER_CELL,                      // STYLE_WORKER_CELL + color
+    STYLE_WORKER_CONNECTOR = STYLE_WORKER_CELL + 8, // STYLE_WORKER_CONNECTOR + color
+    STYLE_COUNT = STYLE_WORKER_CONNECTOR + 8
+};
+
+static const char* style_sequences[STYLE_COUNT] = {
+    "\033[0m",
+    "\033[0;2;36m",        // Dim cyan for explored
+    "\033[0;42;1;30m",     // Green background + bold + black text (start)
+    "\033[0;41;1;97m",     // Red background + bold + white text (goal)
+    // Worker background + bold + black text
+    "\033[0;105;1;30m", "\033[0;106;1;30m", "\033[0;103;1;30m", "\033[0;102;1;30m",
+    "\033[0;104;1;30m", "\033[0;101;1;30m", "\033[0;45;1;30m",  "\033[0;46;1;30m",
+    // Worker background + bold (connectors)
+    "\033[0;105;1m", "\033[0;106;1m", "\033[0;103;1m", "\033[0;102;1m",
+    "\033[0;104;1m", "\033[0;101;1m", "\033[0;45;1m",  "\033[0;46;1m",
+};
+#define NUM_WORKER_COLORS 8
+
+// Worst case bytes needed to redraw one cell and its connector
+#define FRAME_BYTES_PER_CELL 64
+#define FRAME_BUFFER_LIMIT (16 << 20)
+
+void init_frame_renderer(frame_renderer_t *renderer, maze_t maze, uint8_t num_workers) {
+    size_t cells = (size_t)maze.dimensions.x * maze.dimensions.y;
+    renderer->previous = (uint8_t*) malloc(cells);
+    renderer->current = (uint8_t*) malloc(maze.dimensions.x);
+    renderer->worker_grid = (uint8_t*) calloc(cells, sizeof(uint8_t));
+    renderer->marked_cells = (size_t*) malloc(num_workers * sizeof(size_t));
+    // a full frame is at most one style change, one glyph and one cursor
+    // move per character, plus the header. Frames that don't fit are
+    // flushed row by row
+    renderer->capacity = cells * FRAME_BYTES_PER_CELL + 4096;
+    if (renderer->capacity > FRAME_BUFFER_LIMIT)
+        renderer->capacity = FRAME_BUFFER_LIMIT;
+    if (renderer->capacity < (size_t)maze.dimensions.x * FRAME_BYTES_PER_CELL + 4096)
+        renderer->capacity = (size_t)maze.dimensions.x * FRAME_BYTES_PER_CELL + 4096;
+    renderer->buffer = (char*) malloc(renderer->capacity);
+    if (!renderer->previous || !renderer->current || !renderer->buffer ||
+        !renderer->worker_grid || !renderer->marked_cells) {
+        PERROR("Couldn't allocate frame renderer for maze with size: %d x %d",
+               maze.dimensions.x, maze.dimensions.y);
+    }
+    memset(renderer->previous, CELL_NOT_DRAWN, cells);
+    for (uint8_t w = 0; w < num_workers; w++) {
+        renderer->marked_cells[w] = SIZE_MAX;
+    }
+    renderer->length = 0;
+    renderer->style = -1;
+    renderer->first_frame = true;
+}
+
+void free_frame_renderer(frame_renderer_t *renderer) {
+    free(renderer->previous);
+    free(renderer->current);
+    free(renderer->worker_grid);
+    free(renderer->marked_cells);
+    free(renderer->buffer);
+}
+
+static void frame_append(frame_renderer_t *renderer, const char *bytes, size_t count) {
+    memcpy(renderer->buffer + renderer->length, bytes, count);
+    renderer->length += count;
+}
+
+static void frame_append_string(frame_renderer_t *renderer, const char *string) {
+    frame_append(renderer, string, strlen(string));
+}
+
+static void frame_set_style(frame_renderer_t *renderer, int style) {
+    if (renderer->style == style) return;
+    frame_append_string(renderer, style_sequences[style]);
+    renderer->style = style;
+}
+
+static void frame_append_glyph(frame_renderer_t *renderer, direction_t dirs) {
+    const utf8_glyph_t *glyph = &box_glyphs_utf8[dirs & (NORTH|EAST|SOUTH|WEST)];
+    memcpy(renderer->buffer + renderer->length, glyph->bytes, 4);
+    renderer->length += glyph->length;
+}
+
+static void frame_move_cursor(frame_renderer_t *renderer, int_t line, int_t column) {
+    renderer->length += sprintf(renderer->buffer + renderer->length, "\033[%u;%uH", line, column);
+}
+
+// Writes the whole buffer, retrying on partial writes
+static void write_all(int fd, const char *bytes, size_t count) {
+    while (count > 0) {
+        ssize_t written = write(fd, bytes, count);
+        if (written <= 0) return;
+        bytes += written;
+        count -= written;
+    }
+}
+
+// Makes room for a row, flushing what was composed so far if needed
+static void frame_reserve(frame_renderer_t *renderer, size_t bytes) {
+    if (renderer->length + bytes <= renderer->capacity) return;
+    fflush(stdout);
+    write_all(STDOUT_FILENO, renderer->buffer, renderer->length);
+    renderer->length = 0;
+}
+
+// Takes one snapshot of all worker positions for the frame and stores
+// their colors in the position -> worker lookup grid. Colors, not ids, so
+// any number of workers fits the cell states
+static void snapshot_worker_positions(solver_state_t *state, frame_renderer_t *renderer) {
+    maze_t maze = state->maze;
+    for (uint8_t w = 0; w < state->num_workers; w++) {
+        if (renderer->marked_cells[w] != SIZE_MAX) {
+            renderer->worker_grid[renderer->marked_cells[w]] = 0;
+            renderer->marked_cells[w] = SIZE_MAX;
+        }
+    }
+    // Lower worker ids win when two workers share a cell
+    for (int w = state->num_workers - 1; w >= 0; w--) {
+        vec2_t position;
+        if (!read_worker_position(state, w, &position)) continue;
+        if (position.x >= maze.dimensions.x || position.y >= maze.dimensions.y) continue;
+        size_t cell = position.x + (size_t)position.y * maze.dimensions.x;
+        renderer->worker_grid[cell] = w % NUM_WORKER_COLORS + 1;
+        renderer->marked_cells[w] = cell;
+    }
+}
+
+static uint8_t animated_cell_state(solver_state_t *state, frame_renderer_t *renderer, int_t x, int_t y) {
+    uint8_t color = renderer->worker_grid[x + (size_t)y * state->maze.dimensions.x];
+    if (color) {
+        return CELL_WORKER + color - 1;
+    }
+    return explored_at(state->explored, x, y) ? CELL_EXPLORED : CELL_UNEXPLORED;
+}
+
+// Connector to the left of cell x, its style depends on both neighbours
+static void frame_append_connector(frame_renderer_t *renderer, maze_t maze,
+                                   int_t x, int_t y, uint8_t left, uint8_t here) {
+    if (here >= CELL_WORKER) {
+        frame_set_style(renderer, STYLE_WORKER_CONNECTOR + (here - CELL_WORKER));
+    } else if (left >= CELL_WORKER) {
+        frame_set_style(renderer, STYLE_WORKER_CONNECTOR + (left - CELL_WORKER));
+    } else if (here == CELL_EXPLORED || left == CELL_EXPLORED) {
+        frame_set_style(renderer, STYLE_EXPLORED);
+    } else {
+        frame_set_style(renderer, STYLE_PLAIN);
+    }
+    bool connected = (maze_at(maze, x-1, y).open_directions & EAST) &&
+                     (maze_at(maze, x, y).open_directions & WEST);
+    frame_append_glyph(renderer, connected ? (EAST|WEST) : 0);
+}
+
+static void frame_append_cell(solver_state_t *state, frame_renderer_t *renderer,
+                              int_t x, int_t y, uint8_t here) {
+    if (x == 0 && y == 0) {
+        frame_set_style(renderer, STYLE_START);
+    } else if (x == state->goal.x && y == state->goal.y) {
+        frame_set_style(renderer, STYLE_GOAL);
+    } else if (here >= CELL_WORKER) {
+        frame_set_style(renderer, STYLE_WORKER_CELL + (here - CELL_WORKER));
+    } else if (here == CELL_EXPLORED) {
+        frame_set_style(renderer, STYLE_EXPLORED);
+    } else {
+        frame_set_style(renderer, STYLE_PLAIN);
+    }
+    frame_append_glyph(renderer, maze_at(state->maze, x, y).open_directions);
+}
+
+// Print maze with live worker positions (for animation)
+void print_maze_animated(solver_state_t *state, frame_renderer_t *renderer) {
+    maze_t maze = state->maze;
+    int_t width = maze.dimensions.x;
+    
+    snapshot_worker_positions(state, renderer);
+    
+    for (int_t y = 0; y < maze.dimensions.y; y++) {
+        uint8_t *previous = renderer->previous + (size_t)y * width;
+        uint8_t *current = renderer->current;
+        frame_reserve(renderer, (size_t)width * FRAME_BYTES_PER_CELL);
+        
+        for (int_t x = 0; x < width; x++) {
+            current[x] = animated_cell_state(state, renderer, x, y);
+        }
+        
+        // Redraw runs of changed cells, together with the connectors
+        // on both sides of the run
+        int_t x = 0;
+        while (x < width) {
+            if (current[x] == previous[x]) {
+                x++;
+                continue;
+            }
+            int_t run_start = x;
+            while (x < width && current[x] != previous[x]) x++;
+            int_t run_end = x; // exclusive
             
-            print_spchar(ch);
-            wprintf(L"\033[0m");
+            int_t line = HEADER_LINES + 1 + y;
+            if (run_start > 0) {
+                frame_move_cursor(renderer, line, 2 * run_start);
+                frame_append_connector(renderer, maze, run_start, y, current[run_start-1], current[run_start]);
+            } else {
+                frame_move_cursor(renderer, line, 1);
+            }
+            for (int_t cx = run_start; cx < run_end; cx++) {
+                if (cx > run_start) {
+                    frame_append_connector(renderer, maze, cx, y, current[cx-1], current[cx]);
+                }
+                frame_append_cell(state, renderer, cx, y, current[cx]);
+            }
+            if (run_end < width) {
+                frame_append_connector(renderer, maze, run_end, y, current[run_end-1], current[run_end]);
+            }
         }
-        print_spchar(L'\n');
+        memcpy(previous, current, width);
+    }
+    frame_set_style(renderer, STYLE_PLAIN);
+    
+    fflush(stdout);
+    write_all(STDOUT_FILENO, renderer->buffer, renderer->length);
+    renderer->length = 0;
+}
+
+static void frame_append_header(solver_state_t *state, frame_renderer_t *renderer, int active, int frame) {
+    if (renderer->first_frame) {
+        frame_append_string(renderer, "\033[2J");
+        renderer->first_frame = false;
     }
+    frame_append_string(renderer, "\033[H"); // Move to top (don't clear, just overwrite)
+    frame_append_string(renderer, "╔════════════════════════════════════════════════════════╗\n");
+    frame_append_string(renderer, "║             CONCURRENT MAZE SOLVER                     ║\n");
+    frame_append_string(renderer, "╚════════════════════════════════════════════════════════╝\n");
+    renderer->length += sprintf(renderer->buffer + renderer->length,
+                                "Active workers: %d/%d  |  Frame: %d\033[K\n", active, state->num_workers, frame);
+    frame_append_string(renderer, "Legend: ");
+    frame_append_string(renderer, "\033[42m\033[30m▓\033[0m=Start  ");
+    frame_append_string(renderer, "\033[41m\033[97m▓\033[0m=Goal  ");
+    frame_append_string(renderer, "\033[2m\033[36m▓\033[0m=Explored  \n\n");
+    renderer->style = STYLE_PLAIN;
+}
+
+static uint64_t monotonic_microseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
 }
 
 // Visualization thread function
 void* visualizer_thread(void *args) {
     solver_state_t *state = (solver_state_t*) args;
     
-    // Clear screen initially
-    wprintf(L"\033[2J\033[H");
+    frame_renderer_t renderer;
+    init_frame_renderer(&renderer, state->maze, state->num_workers);
+    
+    // Frames are paced by VIZ_MAX_FPS, state->speed only slows the workers down
+    const uint64_t frame_interval = 1000000 / VIZ_MAX_FPS;
     
     int frame = 0;
     while (true) {
+        uint64_t frame_start = monotonic_microseconds();
+        
         pthread_mutex_lock(&state->bifurcations.mutex);
         bool done = state->solution_found || state->shutdown;
         int active = state->active_workers;
@@ -249,32 +648,17 @@ void* visualizer_thread(void *args) {
         
         if (done) break;
         
-        // Clear screen and move cursor to top
-        wprintf(L"\033[H"); // Move to top (don't clear, just overwrite)
-        
-        // Print header
-        wprintf(L"╔════════════════════════════════════════════════════════╗\n");
-        wprintf(L"║             CONCURRENT MAZE SOLVER                     ║\n");
-        wprintf(L"╚════════════════════════════════════════════════════════╝\n");
-        wprintf(L"Active workers: %d/%d  |  Frame: %d\n", active, state->num_workers, frame++);
-        wprintf(L"Legend: ");
-        wprintf(L"\033[42m\033[30m▓\033[0m=Start  ");
-        wprintf(L"\033[41m\033[97m▓\033[0m=Goal  ");
-        wprintf(L"\033[2m\033[36m▓\033[0m=Explored  \n\n");
-        // wprintf(L"Workers:");
-        // wprintf(L"\033[105m\033[30m▓\033[0m");
-        // wprintf(L"\033[106m\033[30m▓\033[0m");
-        // wprintf(L"\033[103m\033[30m▓\033[0m");
-        // wprintf(L"\033[102m\033[30m▓\033[0m");
-        // wprintf(L"\033[104m\033[30m▓\033[0m");
-        // wprintf(L"\033[101m\033[97m▓\033[0m\n\n");
+        frame_append_header(state, &renderer, active, frame++);
         
         // Print maze with workers
-        print_maze_animated(state);
+        print_maze_animated(state, &renderer);
         
-        // Small delay to control animation speed
-        usleep(state->speed); // 50ms = 20 FPS
+        uint64_t elapsed = monotonic_microseconds() - frame_start;
+        if (elapsed < frame_interval) {
+            usleep(frame_interval - elapsed);
+        }
     }
     
+    free_frame_renderer(&renderer);
     return NULL;
 }